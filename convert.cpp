@@ -0,0 +1,40 @@
+/*
+   Convert a graph database in the t/v/e transaction format into the
+   binary format, which gSpan (const char *filename, ...) maps without
+   parsing.  Run once per dataset.
+*/
+#include "gspan.h"
+
+#include <unistd.h>
+
+#define OPT " [-d] input output"
+
+int main (int argc, char **argv)
+{
+  bool directed = false;
+
+  int opt;
+  while ((opt = getopt (argc, argv, "d")) != -1) {
+    switch (opt) {
+    case 'd':
+      directed = true;
+      break;
+    default:
+      std::cerr << "Usage: " << argv[0] << OPT << std::endl;
+      return -1;
+    }
+  }
+
+  if (argc - optind != 2) {
+    std::cerr << "Usage: " << argv[0] << OPT << std::endl;
+    return -1;
+  }
+
+  GSPAN::gSpan gspan (argv[optind], std::cout, 0, 0, false, false, directed);
+  if (! gspan.write (argv[optind + 1])) {
+    std::cerr << "Cannot write " << argv[optind + 1] << std::endl;
+    return -1;
+  }
+
+  return 0;
+}
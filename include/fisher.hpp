@@ -0,0 +1,143 @@
+#ifndef FISHER_HPP
+#define FISHER_HPP
+
+#include <vector>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <cassert>
+
+namespace thesis
+{
+  // Fisher's exact test for a pattern against the two classes:
+  // N = n1 + n2 graphs, the pattern occurs in x of them, a of which in
+  // the first class.  Under the null hypothesis a follows the
+  // hypergeometric distribution
+  //
+  //   P(a | x) = C(n1, a) C(n2, x - a) / C(N, x)
+  //
+  // All the arithmetic is done on logarithms, from a table of log k!
+  // built once, so nothing underflows for NCI1-size N and phi(f) is
+  // O(1).  The tail probabilities of a support x are tabulated the first
+  // time x is asked for, after which a p-value is a lookup.
+  class Fisher
+  {
+  public:
+    Fisher(const unsigned n1, const unsigned n2);
+
+    unsigned n1() const { return n1_; }
+    unsigned n2() const { return n2_; }
+
+    // log C(n, k)
+    double log_choose(const unsigned n, const unsigned k) const
+    { return k > n ? -std::numeric_limits<double>::infinity() : lf_[n] - lf_[k] - lf_[n - k]; }
+
+    // log P(a | x)
+    double log_pmf(const unsigned x, const unsigned a) const
+    { return log_choose(n1_, a) + log_choose(n2_, x - a) - log_choose(N_, x); }
+
+    // phi(f): smallest p-value a pattern of support f can reach,
+    // C(n1, f) / C(N, f) for f <= n1 and 1 / C(N, n1) above
+    double log_min_p(const unsigned f) const
+    { return f <= n1_ ? log_choose(n1_, f) - log_choose(N_, f) : -log_choose(N_, n1_); }
+    double min_p(const unsigned f) const { return std::exp(log_min_p(f)); }
+
+    // one-sided p-value, P(A >= a | x): the pattern is over-represented
+    // in the first class.  Requires[x <= N, lo(x) <= a <= hi(x)]
+    double log_p_value(const unsigned x, const unsigned a) { return tail(x, a).first; }
+    double p_value(const unsigned x, const unsigned a) { return std::exp(log_p_value(x, a)); }
+
+    // two-sided p-value: total probability of the outcomes no more likely
+    // than a.  Requires[x <= N, lo(x) <= a <= hi(x)]
+    double log_p_value_two_sided(const unsigned x, const unsigned a) { return tail(x, a).second; }
+    double p_value_two_sided(const unsigned x, const unsigned a) { return std::exp(log_p_value_two_sided(x, a)); }
+
+    // p-values of all the patterns of a run: sup and sup1 as returned by
+    // gSpan::run() and gSpan::class_support()
+    std::vector<double> p_values(const std::vector<unsigned>& sup, const std::vector<unsigned>& sup1,
+				 const bool two_sided = false);
+
+  private:
+    unsigned n1_, n2_, N_;
+    std::vector<double> lf_; // [k] = log k!
+    std::vector<std::vector<std::pair<double, double> > > tail_; // [x][a - lo(x)] = (one, two-sided)
+
+    // range of a for support x
+    unsigned lo(const unsigned x) const { return x > n2_ ? x - n2_ : 0; }
+    unsigned hi(const unsigned x) const { return std::min(x, n1_); }
+
+    const std::vector<std::pair<double, double> >& tails(const unsigned x);
+    const std::pair<double, double>& tail(const unsigned x, const unsigned a)
+    {
+      assert(x <= N_ && lo(x) <= a && a <= hi(x)); // precondition
+      return tails(x)[a - lo(x)];
+    }
+  };
+
+  // log(exp(a) + exp(b)) without leaving the log domain
+  inline double log_add_(const double a, const double b)
+  {
+    if (a == -std::numeric_limits<double>::infinity()) return b;
+    if (b == -std::numeric_limits<double>::infinity()) return a;
+    return std::max(a, b) + std::log1p(std::exp(-std::fabs(a - b)));
+  }
+
+} // namespace thesis
+
+/**************************************************************************************/
+
+inline thesis::Fisher::Fisher(const unsigned n1, const unsigned n2)
+  : n1_(n1), n2_(n2), N_(n1 + n2), lf_(n1 + n2 + 1, 0.0), tail_(n1 + n2 + 1)
+{
+  for (unsigned k = 2; k <= N_; ++k)
+    lf_[k] = lf_[k - 1] + std::log(static_cast<double>(k));
+}
+
+inline const std::vector<std::pair<double, double> >&
+thesis::Fisher::tails(const unsigned x)
+{
+  auto& t = tail_[x];
+  if (!t.empty()) return t;
+
+  const auto l = lo(x), h = hi(x);
+  std::vector<double> lp(h - l + 1);
+  for (unsigned a = l; a <= h; ++a)
+    lp[a - l] = log_pmf(x, a);
+
+  t.resize(lp.size());
+
+  // one-sided: suffix sums
+  auto acc = -std::numeric_limits<double>::infinity();
+  for (unsigned i = lp.size(); i-- > 0; )
+    t[i].first = acc = log_add_(acc, lp[i]);
+
+  // two-sided: sum of the outcomes in increasing order of probability;
+  // ties (up to rounding) share the sum of the whole run
+  std::vector<unsigned> order(lp.size());
+  for (unsigned i = 0; i < order.size(); ++i) order[i] = i;
+  std::sort(order.begin(), order.end(), [&](const unsigned i, const unsigned j){return lp[i] < lp[j];});
+
+  acc = -std::numeric_limits<double>::infinity();
+  for (unsigned i = 0, j; i < order.size(); i = j) {
+    for (j = i; j < order.size() && lp[order[j]] <= lp[order[i]] + 1e-7; ++j)
+      acc = log_add_(acc, lp[order[j]]);
+    for (unsigned k = i; k < j; ++k)
+      t[order[k]].second = std::min(acc, 0.0);
+  }
+
+  for (auto& p : t) p.first = std::min(p.first, 0.0);
+  return t;
+}
+
+inline std::vector<double>
+thesis::Fisher::p_values(const std::vector<unsigned>& sup, const std::vector<unsigned>& sup1,
+			 const bool two_sided)
+{
+  std::vector<double> p(sup.size());
+  for (std::size_t i = 0; i < sup.size(); ++i) {
+    p[i] = two_sided ? p_value_two_sided(sup[i], sup1[i]) : p_value(sup[i], sup1[i]);
+  }
+  return p;
+}
+
+#endif
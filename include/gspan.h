@@ -22,11 +22,24 @@
 #include <iostream>
 #include <map>
 #include <vector>
+#include <string>
+#include <deque>
 #include <set>
 #include <algorithm>
+#include <cstring>
+#include <memory>
+
+#include <stdint.h>
+#include <functional>
+
+#include "tidset.h"
 
 #include <boost/optional.hpp>
 
+namespace thesis {
+  class Fisher;
+}
+
 namespace GSPAN {
 
   template <class T> inline void _swap (T &x, T &y) { T z = x; x = y; y = z; }
@@ -73,13 +86,144 @@ namespace GSPAN {
     unsigned int edge_size ()   { return edge_size_; }
     unsigned int vertex_size () { return (unsigned int)size(); } // wrapper
     void buildEdge ();
-    std::istream &read (std::istream &); // read
     std::ostream &write (std::ostream &); // write
     void check (void);
 
     Graph(): edge_size_(0), directed(false) {};
   };
 
+  /* Read-only memory mapping of a whole file.
+   */
+  class MappedFile {
+  private:
+    const char  *data_;
+    std::size_t  size_;
+    MappedFile (const MappedFile &);
+    MappedFile &operator= (const MappedFile &);
+
+  public:
+    bool open  (const char *filename);
+    void close ();
+    const char  *data () const { return data_; }
+    std::size_t  size () const { return size_; }
+
+    MappedFile (): data_(0), size_(0) {};
+    ~MappedFile () { close (); }
+  };
+
+  /* Read-only view of one graph of a GraphDB.  Vertex ids are local to the
+   * graph; the adjacency entries of vertex v are [begin (v), end (v)).
+   */
+  class GraphRef {
+  private:
+    const int          *label_;
+    const unsigned int *offset_;
+    const Edge         *edge_;
+    unsigned int        size_;
+    unsigned int        edge_size_;
+
+  public:
+    unsigned int size ()      const { return size_; }
+    unsigned int edge_size () const { return edge_size_; }
+    int          label (int v) const { return label_[v]; }
+    const Edge  *begin (int v) const { return edge_ + offset_[v]; }
+    const Edge  *end   (int v) const { return edge_ + offset_[v+1]; }
+
+    /* Edges by their index in the adjacency array of the database.
+     */
+    const Edge  *edge  (unsigned int i) const { return edge_ + i; }
+    unsigned int index (const Edge *e) const { return e - edge_; }
+
+    GraphRef (const int *_label, const unsigned int *_offset, const Edge *_edge,
+	      unsigned int _size, unsigned int _edge_size):
+      label_(_label), offset_(_offset), edge_(_edge), size_(_size), edge_size_(_edge_size) {};
+  };
+
+  /* Flat (CSR) store for a whole graph database: the vertex labels, the
+   * adjacency offsets and the adjacency entries of all graphs live in one
+   * contiguous array each.  The arrays are either owned or borrowed from a
+   * mapped binary database file.
+   */
+  class GraphDB {
+  private:
+    struct Store {
+      std::vector<unsigned int> vbase;	// [graph] first vertex, graphs+1 entries
+      std::vector<unsigned int> esize;	// [graph] number of edge ids
+      std::vector<int>          label;	// [vertex] label
+      std::vector<unsigned int> offset;	// [vertex] first adjacency entry, vertices+1 entries
+      std::vector<Edge>         edge;	// adjacency entries
+    } store_;
+    std::shared_ptr<MappedFile> file_;
+
+    /* Arrays in use, pointing into store_ or into file_.
+     */
+    const unsigned int *vbase_;
+    const unsigned int *esize_;
+    const int          *label_;
+    const unsigned int *offset_;
+    const Edge         *edge_;
+    unsigned int        size_;
+
+    std::vector<unsigned int> cursor_;	// scratch for end_graph ()
+
+    void own ();
+    void repoint ();
+    bool owned () const { return vbase_ == store_.vbase.data (); }
+
+  public:
+    bool directed;
+
+    /* Graph under construction: fill the vertex labels and add edges with
+     * push_edge, then append the graph with end_graph ().
+     */
+    std::vector<int>  new_label;
+    std::vector<Edge> new_edge;
+
+    void push_edge (int from, int to, int elabel)
+    {
+      new_edge.resize (new_edge.size()+1);
+      new_edge.back().from = from;
+      new_edge.back().to = to;
+      new_edge.back().elabel = elabel;
+      if (directed == false) {
+	new_edge.resize (new_edge.size()+1);
+	new_edge.back().from = to;
+	new_edge.back().to = from;
+	new_edge.back().elabel = elabel;
+      }
+    }
+    void end_graph ();
+
+    unsigned int size () const { return size_; }
+    bool empty () const { return size_ == 0; }
+    GraphRef operator[] (unsigned int id) const
+    {
+      return GraphRef (label_ + vbase_[id], offset_ + vbase_[id], edge_,
+		       vbase_[id+1] - vbase_[id], esize_[id]);
+    }
+    void clear ();
+    void append (const GraphDB &);
+    void push (const GraphRef &);
+
+    /* Use the arrays of g in place; g must outlive this database or
+     * its next modification.
+     */
+    void borrow (const GraphDB &g);
+
+    /* Binary database format, see binary.cpp.  map () adopts the arrays of
+     * a mapped file in place; it returns false if the file is not a binary
+     * database.
+     */
+    bool write (const char *filename) const;
+    bool map (const std::shared_ptr<MappedFile> &file);
+
+    GraphDB (bool _directed = false);
+    GraphDB (const GraphDB &);
+    GraphDB (GraphDB &&) = default;
+    GraphDB &operator= (const GraphDB &);
+    GraphDB &operator= (GraphDB &&) = default;
+  };
+
   class DFS {
   public:
     int from;
@@ -107,6 +251,7 @@ namespace GSPAN {
     /* Convert current DFS code into a graph.
      */
     bool toGraph (Graph &);
+    bool toGraph (GraphDB &); // single graph database
 
     /* Clear current DFS code and build code from the given graph.
      */
@@ -118,47 +263,232 @@ namespace GSPAN {
 
     void push (int from, int to, int fromlabel, int elabel, int tolabel)
     {
-      resize (size() + 1);
-      DFS &d = (*this)[size()-1];
+      DFS d;
 
       d.from = from;
       d.to = to;
       d.fromlabel = fromlabel;
       d.elabel = elabel;
       d.tolabel = tolabel;
+      push_back (d);
     }
-    void pop () { resize (size()-1); }
+    void pop () { pop_back (); }
     std::ostream &write (std::ostream &); // write
   };
 
+  /* One embedding of a pattern of k edges: its last edge, as an index into
+   * the adjacency array of the database, and the embedding of the first k-1
+   * edges it extends, as an index into the embedding array of depth k-1.
+   * 12 bytes rather than the 24 of two pointers.
+   */
   struct PDFS {
     unsigned int id;	// ID of the original input graph
-    Edge        *edge;
-    PDFS        *prev;
+    unsigned int edge;
+    unsigned int prev;
     PDFS(): id(0), edge(0), prev(0) {};
   };
 
-  class History: public std::vector<Edge*> {
+  /* Embedding arrays by depth: [k] holds the embeddings of patterns of k+1
+   * edges, which the prev indices of depth k+1 refer to.
+   */
+  struct EmbeddingLevels: public std::vector<const PDFS *> {
+    void set (unsigned int k, const PDFS *p)
+    {
+      if (size () <= k)
+	resize (k + 1);
+      (*this)[k] = p;
+    }
+  };
+
+  /* Edges of one embedding in DFS code order, and the edges and vertices
+   * they cover.  Coverage is kept in stamped arrays: an entry is set iff
+   * it is >= base, so starting over for a new embedding costs nothing
+   * instead of zeroing O(V+E).  Consecutive builds of embeddings that
+   * share a prefix (siblings of one Projected) only redo the positions
+   * past it.  Graphs with more than SPARSE edges are not given arrays at
+   * all; the few edges of the embedding are scanned instead.
+   */
+  class History: public std::vector<const Edge*> {
   private:
-    std::vector<int> edge;
-    std::vector<int> vertex;
+    std::vector<unsigned int> edge;	// base + first position covering an edge
+    std::vector<unsigned int> vertex;	// base + first position covering a vertex
+    std::vector<unsigned int> pdfs;	// embedding of every position of the last build
+    unsigned int base;
+    unsigned int top;			// largest stamp written
+    bool sparse;
+
+    void mark (unsigned int pos);
+    void unmark (unsigned int pos);
 
   public:
-    bool hasEdge   (unsigned int id) { return (bool)edge[id]; }
-    bool hasVertex (unsigned int id) { return (bool)vertex[id]; }
-    void build     (Graph &, PDFS *);
-    History() {};
-    History (Graph& g, PDFS *p) { build (g, p); }
+    static const unsigned int SPARSE = 1 << 16;
+
+    bool hasEdge (unsigned int id)
+    {
+      if (! sparse)
+	return edge[id] >= base;
+      for (const_iterator it = begin (); it != end (); ++it)
+	if ((*it)->id == id)
+	  return true;
+      return false;
+    }
+    bool hasVertex (unsigned int id)
+    {
+      if (! sparse)
+	return vertex[id] >= base;
+      for (const_iterator it = begin (); it != end (); ++it)
+	if ((*it)->from == (int)id || (*it)->to == (int)id)
+	  return true;
+      return false;
+    }
+    /* History of embedding index of the patterns of depth edges.
+     */
+    void build     (const GraphRef &, const EmbeddingLevels &, unsigned int depth, unsigned int index);
+
+    /* Forget the last build; needed before its embeddings may be freed.
+     */
+    void restart () { clear (); pdfs.clear (); }
+
+    History(): base(1), top(0), sparse(false) {};
 
   };
 
-  class Projected: public std::vector<PDFS> {
+  /* Embedding list of one pattern: a range of the embedding array it was
+   * collected in, starting at index first of that array.
+   */
+  class Projected {
+  private:
+    PDFS *begin_;
+    PDFS *end_;
+    unsigned int first_;
+
+  public:
+    typedef PDFS *iterator;
+
+    Projected (): begin_(0), end_(0), first_(0) {};
+    Projected (PDFS *b, PDFS *e, unsigned int first = 0): begin_(b), end_(e), first_(first) {};
+    unsigned int index (unsigned int n) const { return first_ + n; }	// in the array
+    iterator begin () const { return begin_; }
+    iterator end () const { return end_; }
+    unsigned int size () const { return end_ - begin_; }
+    bool empty () const { return begin_ == end_; }
+    PDFS &operator[] (unsigned int n) const { return begin_[n]; }
+  };
+
+  /* Candidate extensions of a pattern.  Embeddings are pushed in one flat
+   * buffer under a packed 64-bit key, a small open addressing hash assigning
+   * each key its group; sort () then orders the groups by key and moves the
+   * embeddings into one contiguous run per group, keeping their push order.
+   * Group g is the Projected of operator[] (g).  Keys order like the DFS
+   * code extensions: backward extensions (by to, elabel) before forward
+   * ones (by descending from, elabel, tolabel).  Vertex ids and labels must
+   * be below 2^21.  If a filter is set, it is asked once about every new
+   * key, and the embeddings of rejected keys are not stored at all.
+   */
+  class ExtensionTable {
+  public:
+    typedef std::function<bool (uint64_t)> Filter;
+
+  private:
+    std::vector<PDFS>         pdfs_;	// pushed embeddings, grouped by sort ()
+    std::vector<unsigned int> slot_;	// group of every pushed embedding
+    std::vector<uint64_t>     group_;	// key of every group
+    std::vector<char>         alive_;	// group accepted by the filter
+    std::vector<unsigned int> start_;	// group g is pdfs_[start_[g], start_[g+1])
+    std::vector<uint64_t>     hkey_;	// hash: key -> group
+    std::vector<unsigned int> hgroup_;
+    std::vector<unsigned int> hused_;	// slots of hgroup_ in use
+    std::vector<unsigned int> order_;	// sort buffers
+    std::vector<unsigned int> rank_;
+    std::vector<uint64_t>     sorted_key_;
+    std::vector<PDFS>         sorted_;
+    uint64_t                  last_;	// key and group of the last push
+    unsigned int              last_group_;
+    Filter                    filter_;
+
+    unsigned int insert (uint64_t key);
+
   public:
-    void push (int id, Edge *edge, PDFS *prev)
+    static const uint64_t FORWARD = (uint64_t)1 << 63;
+    static const int      MAXID   = 0x1fffff;
+
+    static uint64_t pack (int a, int b, int c)
+    {
+      return ((uint64_t)a << 42) | ((uint64_t)b << 21) | (uint64_t)c;
+    }
+    static int field (uint64_t key, int n) { return (key >> (42 - 21 * n)) & MAXID; }
+
+    static uint64_t backward (int to, int elabel) { return pack (to, elabel, 0); }
+    static uint64_t forward (int from, int elabel, int tolabel)
+    {
+      return FORWARD | pack (MAXID - from, elabel, tolabel);
+    }
+    static uint64_t root (int fromlabel, int elabel, int tolabel) { return pack (fromlabel, elabel, tolabel); }
+    static bool is_forward (uint64_t key) { return key & FORWARD; }
+
+    /* clear () also drops the filter.
+     */
+    void clear ();
+    void filter (const Filter &f) { filter_ = f; }
+    bool empty () const { return pdfs_.empty (); }
+    void push (uint64_t key, unsigned int id, unsigned int edge, unsigned int prev)
     {
-      resize (size() + 1);
-      PDFS &d = (*this)[size()-1];
+      /* Runs of equal keys are common (all edges of one vertex).
+       */
+      if (group_.empty () || key != last_) {
+	last_ = key;
+	last_group_ = insert (key);
+      }
+      if (! alive_[last_group_])
+	return;
+
+      slot_.push_back (last_group_);
+      PDFS d;
       d.id = id; d.edge = edge; d.prev = prev;
+      pdfs_.push_back (d);
+    }
+    void sort ();
+
+    /* Replace the (cleared) table by the union of the sorted tables part,
+     * in key order; the embeddings of a key are those of part[0], then
+     * those of part[1], and so on.  Copying is done on up to threads
+     * threads.
+     */
+    void merge (const std::vector<const ExtensionTable *> &part, unsigned int threads);
+
+    /* Number of groups, their key and embeddings; valid after sort ().
+     */
+    unsigned int size () const { return group_.size (); }
+    uint64_t key (unsigned int g) const { return group_[g]; }
+    bool is_forward (unsigned int g) const { return is_forward (group_[g]); }
+    int fromlabel (unsigned int g) const { return field (group_[g], 0); }	// root
+    int from (unsigned int g) const { return MAXID - field (group_[g], 0); } // forward
+    int to (unsigned int g) const { return field (group_[g], 0); }		// backward
+    int elabel (unsigned int g) const { return field (group_[g], 1); }
+    int tolabel (unsigned int g) const { return field (group_[g], 2); }
+    Projected operator[] (unsigned int g)
+    {
+      return Projected (pdfs_.data () + start_[g], pdfs_.data () + start_[g+1], start_[g]);
+    }
+    const PDFS *data () const { return pdfs_.data (); }
+  };
+
+  /* Extension tables indexed by DFS code depth.  Entering a depth clears
+   * its table but keeps the memory, so the children of all siblings reuse
+   * the same buffers and steady state mining does no allocation.  Tables
+   * never move, as the embeddings of shallower depths are still in use.
+   */
+  class ExtensionArena {
+  private:
+    std::deque<ExtensionTable> table_;
+
+  public:
+    ExtensionTable &enter (unsigned int depth)
+    {
+      while (table_.size () <= depth)
+	table_.push_back (ExtensionTable ());
+      table_[depth].clear ();
+      return table_[depth];
     }
   };
 
@@ -172,29 +502,36 @@ namespace GSPAN {
       void push (unsigned int, unsigned int);   // set two nodes
       }; */
 
-  typedef std::vector <Edge*> EdgeList;
+  typedef std::vector <const Edge*> EdgeList;
 
-  bool  get_forward_pure   (Graph&, Edge *,  int,    History&, EdgeList &);
-  bool  get_forward_rmpath (Graph&, Edge *,  int,    History&, EdgeList &);
+  bool  get_forward_pure   (const GraphRef&, const Edge *, int, History&, EdgeList &);
+  bool  get_forward_rmpath (const GraphRef&, const Edge *, int, History&, EdgeList &);
+  bool  get_forward_root   (const GraphRef&, int, EdgeList &);
   bool  get_forward_root   (Graph&, Vertex&, EdgeList &);
-  Edge *get_backward       (Graph&, Edge *,  Edge *, History&);
+  const Edge *get_backward (const GraphRef&, const Edge *, const Edge *, History&);
 
   class gSpan {
 
   private:
 
-    typedef std::map<int, std::map <int, std::map <int, Projected> > >           Projected_map3;
-    typedef std::map<int, std::map <int, Projected> >                            Projected_map2;
-    typedef std::map<int, Projected>                                             Projected_map1;
-    typedef std::map<int, std::map <int, std::map <int, Projected> > >::iterator Projected_iterator3;
-    typedef std::map<int, std::map <int, Projected> >::iterator                  Projected_iterator2;
-    typedef std::map<int, Projected>::iterator                                   Projected_iterator1;
-    typedef std::map<int, std::map <int, std::map <int, Projected> > >::reverse_iterator Projected_riterator3;
-
-    std::vector < Graph >       TRANS;
+    GraphDB                     INPUT;	// database as read
+    GraphDB                     TRANS;	// pruned and relabeled copy that is mined
     DFSCode                     DFS_CODE;
     DFSCode                     DFS_CODE_IS_MIN;
-    Graph                       GRAPH_IS_MIN;
+    GraphDB                     GRAPH_IS_MIN;
+    History                     HISTORY;	// scratch of the extension loops
+    EdgeList                    EDGES;
+    ExtensionArena              EXTENSIONS;
+    std::deque<std::vector<PDFS> > PROJECTED_IS_MIN;	// [depth] embeddings of is_min
+    EmbeddingLevels             LEVEL;	// embedding arrays of the patterns on DFS_CODE
+    EmbeddingLevels             LEVEL_IS_MIN;
+    std::deque<TidSet>          TIDS;	// [depth] graphs of the pattern
+
+    /* Pattern being extended, for frequent_extension ().
+     */
+    std::vector<int>            PATTERN_LABEL;
+    const TidSet               *PATTERN_TIDS;
+    int                         PATTERN_MAXTOC;
 
     unsigned int ID;
     unsigned int minsup;
@@ -203,6 +540,31 @@ namespace GSPAN {
     bool where;
     bool enc;
     bool directed;
+    unsigned int threads;
+    bool terminated;	// c_run_m: the termination condition was met
+    bool prepared;	// TRANS and TRIPLES are those of minsup
+
+    /* Decreasing threshold searches (see frontier.cpp): while resuming,
+     * minsup is the floor and threshold the current support threshold
+     * (0 otherwise); FRONTIER holds the patterns pruned for being below
+     * it, with their embeddings (as in flatten ()).
+     */
+    struct FrontierEntry {
+      DFSCode           code;
+      unsigned int      sup;
+      std::vector<PDFS> flat;
+    };
+    unsigned int               threshold;
+    std::vector<FrontierEntry> FRONTIER;
+    bool                       resuming;
+
+    /* Increasing threshold searches (c_run_m (), see frontier.cpp): while
+     * early is set, minsup is the floor, threshold the last min_sup, and
+     * FRONTIER holds the extensions the termination left unexplored.
+     */
+    bool early;
+    void postpone (const Projected &);
+    std::size_t resume_early (const unsigned min_sup, double min_pv, double alpha);
     std::ostream* os;
 
     /* Singular vertex handling stuff
@@ -211,6 +573,20 @@ namespace GSPAN {
     std::map<unsigned int, std::map<unsigned int, unsigned int> > singleVertex;
     std::map<unsigned int, unsigned int> singleVertexLabel;
 
+    /* Labels of TRANS are dense ranks; [rank] = label in INPUT.
+     */
+    std::vector<int> origVertexLabel;
+    std::vector<int> origEdgeLabel;
+
+    /* Graphs of every frequent (fromlabel, elabel, tolabel) triple of TRANS,
+     * sorted by packed triple; read only, shared with the workers.
+     */
+    struct TripleIndex {
+      std::vector<uint64_t> key;
+      std::vector<TidSet>   tids;
+    };
+    std::shared_ptr<const TripleIndex> TRIPLES;
+
     /* Graph boosting variables
      */
     bool boost;
@@ -230,6 +606,57 @@ namespace GSPAN {
 
     // storing frequent graphs
     std::vector<unsigned> results_;
+    std::vector<unsigned> class_results_;	// [pattern] = support within the first class
+
+    /* In support_histogram () runs the supports are only counted:
+     * histogram_[sup] = number of patterns of support sup.
+     */
+    bool counting;
+    std::vector<std::size_t> histogram_;
+
+    /* lamp () runs: minsup is raised during the search while the
+     * lampcount patterns of support >= minsup are more than
+     * lampalpha / phi (minsup).
+     */
+    const thesis::Fisher *LAMP;
+    double                lampalpha;
+    std::size_t           lampcount;
+    void raise_support ();
+
+    /* westfall_young () runs: PERMUTED[j] holds the graphs of the first
+     * class under label permutation j, and wymin[j] the smallest p-value
+     * of the patterns found so far under it.
+     */
+    thesis::Fisher     *WY;
+    double              wyalpha;
+    std::vector<TidSet> PERMUTED;
+    std::vector<double> wymin;
+    double              wymax;	// max of wymin
+    void permutation_test (const TidSet &tids, unsigned int sup);
+
+    void record (unsigned int sup, unsigned int sup1)
+    {
+      if (counting) {
+	if (histogram_.size () <= sup)
+	  histogram_.resize (sup + 1, 0);
+	++histogram_[sup];
+	if (LAMP && sup >= minsup) {
+	  ++lampcount;
+	  raise_support ();
+	}
+      } else {
+	results_.push_back (sup);
+	class_results_.push_back (sup1);
+      }
+    }
+
+    /* Class sizes; graphs of the minority class have ids [0, n1_).
+     * inputOrder[id] = position of graph id in the input file.
+     */
+    unsigned int n1_;
+    unsigned int n2_;
+    std::vector<unsigned int> inputOrder;
+    unsigned int input_id (unsigned int id) const { return inputOrder.empty () ? id : inputOrder[id]; }
 
     /* Transparent pointers for gain function and gain bound.
      */
@@ -252,34 +679,190 @@ namespace GSPAN {
 
     bool is_min ();
     bool project_is_min (Projected &);
+    std::vector<PDFS> &projected_is_min (unsigned int);
 
     std::map<unsigned int, unsigned int> support_counts (Projected &projected);
-    unsigned int support (Projected&);
+    unsigned int support (Projected&, TidSet &tids, unsigned int &sup1);
+    bool frequent_extension (uint64_t key);
+    TidSet &tids_at (unsigned int depth);
+    const TidSet *triple_tids (int fromlabel, int elabel, int tolabel);
     
     void project         (Projected &);
     void project (Projected &, double min_pv, double alpha);
     
-    void report         (Projected &, unsigned int);
+    void report         (Projected &, unsigned int, unsigned int);
 
     std::istream &read (std::istream &);
+    void read (const char *filename);
+    void read (const char *begin, const char *end); // parse in place
+    void read_gzip (const char *data, std::size_t size);
+    void read_text (const char *data, std::size_t size);	// plain or gzip
+
+    void init (std::ostream &_os,
+	       unsigned int _maxpat_min, unsigned int _maxpat_max,
+	       bool _enc,
+	       bool _where,
+	       bool _directed);
+
+    void preprocess ();
+    void restore_labels (Graph &);
+    void reset (unsigned int min_sup);
 
     void run_intern (void);
+    void count_single_vertices ();
+
+    /* Worker of the parallel miner: a gSpan sharing TRANS and the
+     * preprocessing results of parent, see parallel.cpp.
+     */
+    explicit gSpan (const gSpan &parent, unsigned int);
+    void project_roots (ExtensionTable &root);
+
+    /* Work stealing below the roots: project () may hand a child
+     * extension to the pool instead of recursing into it.
+     */
+    struct MineTask;
+    class TaskPool;
+    TaskPool    *POOL;		// 0 outside the parallel miner
+    MineTask    *TASK;		// task being mined, receives the splice points
+    unsigned int WORKER;	// index of the thread of this worker
+    bool spawn (Projected &);
+    void run_task (MineTask &);
+    void flatten (const Projected &, std::vector<PDFS> &flat);
+    Projected unflatten (const DFSCode &, std::vector<PDFS> &flat);
+    unsigned int claim_threads (unsigned int n);
+    void release_threads (unsigned int n);
+
+    /* Extensions of the embeddings of large patterns are collected on
+     * several threads, into one table per slice of the graph ids.
+     */
+    struct EnumSlice {
+      ExtensionTable table;
+      History        history;
+      EdgeList       edges;
+    };
+    std::vector<EnumSlice> SLICES;
+    ExtensionTable &enumerate (Projected &, TidSet &, const RMPath &);
+    ExtensionTable &root_table ();
+
+    /* Mining on worker processes, see distributed.cpp.
+     */
+    std::vector<std::string> WORKER_HOSTS;	// "host:port" of every worker
+    std::vector<int>         WORKER_PIDS;	// workers started by fork_workers ()
+    void project_remote (ExtensionTable &root);
+    bool serve_connection (int fd);
+    void serve_socket (int fd);
+    void enumerate (Projected &, unsigned int begin, unsigned int end, const RMPath &,
+		    ExtensionTable &, History &, EdgeList &);
 
     void run_intern (double min_pv, double alpha);
 
   public:
 
+    /* A gSpan holds the whole database; it is loaded once and mined with
+     * any number of run () or c_run_m () calls, but never copied.
+     */
+    gSpan (const gSpan &) = delete;
+    gSpan &operator= (const gSpan &) = delete;
+
     gSpan(std::istream &is, std::ostream &_os,
 	  unsigned int _maxpat_min, unsigned int _maxpat_max,
 	  bool _enc,
 	  bool _where,
 	  bool _directed);
+
+    /* Map the file and parse it in place (faster than the istream path).
+     */
+    gSpan(const char *filename, std::ostream &_os,
+	  unsigned int _maxpat_min, unsigned int _maxpat_max,
+	  bool _enc,
+	  bool _where,
+	  bool _directed);
     
+    /* Save the database in the binary format; a gSpan constructed
+     * from the resulting file loads it without parsing.
+     */
+    bool write (const char *filename);
+
+    /* Read one class label per graph (input order) and move the graphs of
+     * the least frequent label to the front, so that they get ids [0, n1).
+     */
+    void read_classes (const char *filename);
+    unsigned int n1 () const { return n1_; }
+    unsigned int n2 () const { return n2_; }
+
+    /* Support within the first class of each pattern of the last run,
+     * parallel to the vector returned by run ().
+     */
+    const std::vector<unsigned>& class_support () const { return class_results_; }
+
+    /* Number of threads used by the parallel parts (default: all cores).
+     */
+    void set_threads (unsigned int n) { threads = n ? n : 1; }
+
+    /* Mine the subtrees of the root edges on worker processes rather
+     * than on threads.  A worker is a gSpan loaded with the same database
+     * (and class file) running serve (); the graphs and the results are
+     * exchanged in network byte order.  fork_workers () starts n workers
+     * on this host, listening on the loopback interface; stop_workers ()
+     * shuts down the workers of this object.
+     */
+    void add_worker (const std::string &address);	// "host:port"
+    void fork_workers (unsigned int n);
+    void stop_workers ();
+    bool check_workers (unsigned int n, const unsigned min_sup);	// same result as run (min_sup)?
+
+    /* Serve coordinators on port of the interface with address until one
+     * of them stops the worker.  Coordinators are not authenticated, so
+     * only the loopback interface is served unless asked otherwise.
+     */
+    void serve (unsigned short port, const std::string &address = "127.0.0.1");
+
+    /* Supports (numbers of graphs) of the patterns of support >= min_sup.
+     */
     std::vector<unsigned> run(const unsigned min_sup);
 
+    /* m(min_sup), except that mining stops as soon as the count exceeds
+     * alpha / min_pv (the result is then some count above it).  Calls
+     * with non-decreasing min_sup continue from where the previous one
+     * stopped instead of starting over.
+     */
     std::size_t
     c_run_m(const unsigned min_sup, double min_pv, double alpha);
 
+    /* Mine once at min_sup, counting the patterns by support instead of
+     * storing the supports.  Entry f of the result is m(f), the number of
+     * patterns of support >= f, for every f >= min_sup (the lower entries
+     * repeat m(min_sup)); the last entry is 0.
+     */
+    std::vector<std::size_t> support_histogram (const unsigned min_sup);
+
+    /* Mining at a sequence of non-increasing thresholds, all >= floor.
+     * begin_resume () preprocesses the database once for floor; every
+     * resume (f) then only mines the subtrees that the previous one
+     * pruned as infrequent (from the roots, the first time), keeps the
+     * patterns found so far, and returns m(f), the number of patterns of
+     * support >= f.  class_support () covers all the patterns found.
+     */
+    void begin_resume (const unsigned floor);
+    std::size_t resume (const unsigned min_sup);
+
+    /* LAMP: the root frequency (smallest support whose patterns can be
+     * tested at level alpha with Bonferroni correction, as th::lamp_dec_
+     * finds it) in one search, during which minsup is raised as soon as
+     * the patterns found so far rule the lower supports out.  Needs the
+     * classes (read_classes ()).
+     */
+    unsigned int lamp (const double alpha);
+
+    /* Westfall-Young permutation testing (WYlight) in one search: every
+     * pattern found is tested (one-sided Fisher) under J random
+     * permutations of the classes, drawn from seed, and minsup is raised
+     * as soon as the smallest p-values of the permutations rule the lower
+     * supports out.  Returns the corrected significance threshold: the
+     * patterns with p-value below it are significant with family-wise
+     * error rate alpha.  Needs the classes (read_classes ()).
+     */
+    double westfall_young (const unsigned int J, const double alpha, const unsigned int seed = 0);
 
     /* boostType: 1 for 1.5-class LPBoosting, 2 for 2-class LPBoosting
      */
@@ -296,8 +879,6 @@ namespace GSPAN {
     // 	      bool _where,
     // 	      bool _directed);
 
-
   };
 };
 
-
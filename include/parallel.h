@@ -0,0 +1,54 @@
+/*
+  Minimal thread helpers shared by the parallel loader and miner.
+*/
+#ifndef GSPAN_PARALLEL_H
+#define GSPAN_PARALLEL_H
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+namespace GSPAN {
+
+  /* Number of threads to use when the caller does not say otherwise.
+   */
+  inline unsigned int default_threads ()
+  {
+    unsigned int n = std::thread::hardware_concurrency ();
+    return n ? n : 1;
+  }
+
+  /* Call fn (i, t) for every i in [0, n) on at most `threads' threads, t
+   * being the index of the calling thread.  Indices are handed out one at
+   * a time, so uneven items balance themselves.  With one thread (or one
+   * item) everything runs on the caller.
+   */
+  template <class F>
+  void parallel_for (unsigned int n, unsigned int threads, F fn)
+  {
+    if (threads > n)
+      threads = n;
+
+    if (threads <= 1) {
+      for (unsigned int i = 0; i < n; ++i)
+	fn (i, 0u);
+      return;
+    }
+
+    std::atomic<unsigned int> next (0);
+    auto worker = [&] (unsigned int t) {
+      for (unsigned int i; (i = next++) < n; )
+	fn (i, t);
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned int t = 1; t < threads; ++t)
+      pool.push_back (std::thread (worker, t));
+    worker (0);
+    for (unsigned int t = 0; t < pool.size (); ++t)
+      pool[t].join ();
+  }
+
+}
+
+#endif
@@ -2,6 +2,7 @@
 #define TESTABILITY_HPP
 
 #include "config.hpp"
+#include "fisher.hpp"
 
 #include <vector>
 #include <string>
@@ -9,6 +10,7 @@
 #include <cmath>
 #include <utility>
 #include <type_traits>
+#include <memory>
 
 #include <boost/math/tools/roots.hpp>
 #include <boost/math/special_functions/binomial.hpp>
@@ -47,6 +49,19 @@ namespace thesis
   unsigned
   lamp_dec_(Algorithm m, const unsigned n1, const unsigned n2, const double alpha);
 
+  // the same search on a resumable session: begin(floor) prepares the
+  // database once (gSpan::begin_resume), resume(f) = m(f) for
+  // non-increasing f >= floor, mining only what the previous f pruned
+  // (gSpan::resume)
+  template<typename Begin, typename Resume>
+  unsigned
+  lamp_dec_(Begin begin, Resume resume, const unsigned n1, const unsigned n2, const double alpha);
+
+  // hist(f) = cumulative support histogram mined at f (gSpan::support_histogram)
+  template<typename Histogram>
+  unsigned
+  lamp_hist_(Histogram hist, const unsigned n1, const unsigned n2, const double alpha);
+
   template<typename Algorithm>
   unsigned
   early_term_(Algorithm m_et, const unsigned n1, unsigned n2, const double alpha);
@@ -65,25 +80,14 @@ namespace th = thesis;
 // Out: (double) phi(f) 
 double th::min_p_(const unsigned n1, const unsigned n2, const Frequency f)
 {
-
-  using namespace ranges;
-
-  auto N = n1 + n2;
-  BOOST_ASSERT(f < N); // precondition
+  BOOST_ASSERT(f < n1 + n2); // precondition
   BOOST_ASSERT(n1 > 0);
-  auto op2 = [](const auto a, const auto b) { // correctly compute n/m
-    return static_cast<double>(a) / static_cast<double>(b);};
-
-  auto init_v = static_cast<double>(n1) / static_cast<double>(N); // init value
-
-  auto base1 = f > n1 ? 1u : n1 - f + 1;
-  auto base2 = f > n1 ? N - n1 + 1 : N - f + 1;
-
-  auto r1 = view::iota(base1,n1); // {base1, base1+1, ..., n1}
-  auto r2 = view::iota(base2,N); // {base2, base2+1, ..., N}
-  return inner_product(r1, r2, init_v, std::multiplies<>{}, op2); // calculate base1/base2 x (base1 + 1)/(base2 + 1) x ... x n1/N
-
 
+  // log-factorial tables of the last (n1, n2): phi(f) in O(1), no underflow
+  static thread_local std::unique_ptr<th::Fisher> fisher;
+  if (!fisher || fisher->n1() != n1 || fisher->n2() != n2)
+    fisher.reset(new th::Fisher(n1, n2));
+  return fisher->min_p(f);
 }
 
 template<typename Algorithm>
@@ -127,6 +131,53 @@ th::lamp_dec_(Algorithm m, const unsigned n1, const unsigned n2, const double al
   return *find_if(freq_rng, pred) + 1; 
 }
 
+template<typename Begin, typename Resume>
+unsigned
+th::lamp_dec_(Begin begin_, Resume resume, const unsigned n1, const unsigned n2, const double alpha)
+{
+  using namespace ranges;
+  const auto phi = [=](const auto f){return th::min_p_(n1, n2, f);}; // minimum p-value function
+  auto adm_rng = view::iota(1u,n1) | view::remove_if([=](const auto f){
+      return phi(f) > alpha;});
+  const auto first = begin(adm_rng);
+  const auto min_freq = first == end(adm_rng) ? n1 : *first; // below it phi(f) > alpha alone fails f
+
+  begin_(min_freq); // the floor: every resume(f) below has f >= min_freq
+  const auto pred = [&](const auto f){
+    const auto m_ = resume(f); BOOST_ASSERT(m_ > 0);
+    return m_ * phi(f) > alpha;};
+
+  // {n1 - 1, ..., min_freq}, in the non-increasing order resume() needs
+  auto freq_rng = view::iota(min_freq,n1) | view::reverse;
+  const auto it = find_if(freq_rng, pred);
+  return it == end(freq_rng) ? min_freq : *it + 1;
+}
+
+template<typename Histogram>
+unsigned
+th::lamp_hist_(Histogram hist, const unsigned n1, const unsigned n2, const double alpha)
+{
+  using namespace ranges;
+  const auto phi = [=](const auto f){return th::min_p_(n1, n2, f);}; // minimum p-value function
+  auto freq_rng = view::iota(1u,n1) | view::remove_if([=](const auto f){
+      return phi(f) > alpha;});
+  const auto first = begin(freq_rng);
+  if (first == end(freq_rng)) return n1; // phi(f) > alpha for every f: nothing to mine
+  const auto min_freq = *first; // min. admissible frequency for mining at significance level: alpha
+
+  const auto m = hist(min_freq); // mine once: m[f] = m(f) for every f >= min_freq
+  const auto pred = [&](const auto f){
+    if (f < min_freq) return true; // phi(f) > alpha, so m(f) * phi(f) > alpha
+    const auto m_ = f < m.size() ? m[f] : 0;
+    return m_ * phi(f) > alpha;};
+
+  // same search as lamp_dec_, with m(f) looked up
+  const auto lo = min_freq > 1 ? min_freq - 1 : 1u;
+  auto rng = view::iota(lo,n1) | view::reverse;
+  const auto it = find_if(rng, pred);
+  return it == end(rng) ? lo : *it + 1; // no f fails: every f >= lo is testable
+}
+
 template<typename Algorithm>
 unsigned
 th::early_term_(Algorithm m_et, const unsigned n1, const unsigned n2, const double alpha){
@@ -0,0 +1,76 @@
+/*
+  Bitset over graph ids (transaction ids) of the mined database.
+*/
+#ifndef GSPAN_TIDSET_H
+#define GSPAN_TIDSET_H
+
+#include <vector>
+#include <stdint.h>
+
+/* The counting loops are compiled twice on x86, with and without the
+ * POPCNT instruction, and the loader picks the version the CPU runs, so
+ * that portable binaries still count in hardware.
+ */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && ! defined(__POPCNT__)
+#define TIDSET_CLONES __attribute__ ((target_clones ("popcnt", "default")))
+#else
+#define TIDSET_CLONES
+#endif
+
+namespace GSPAN {
+
+  /* One bit per graph.  Counting goes through the popcount builtin, which
+   * becomes the POPCNT instruction where the CPU has it (see
+   * TIDSET_CLONES), and the word loops are simple enough for the
+   * compiler to vectorize.
+   */
+  class TidSet {
+  private:
+    std::vector<uint64_t> word_;
+
+    static unsigned int popcount (uint64_t w) { return __builtin_popcountll (w); }
+
+  public:
+    /* Make the set empty and able to hold ids [0, n).
+     */
+    void reset (unsigned int n) { word_.assign ((n + 63) / 64, 0); }
+
+    void set (unsigned int i) { word_[i >> 6] |= (uint64_t)1 << (i & 63); }
+    bool test (unsigned int i) const { return (word_[i >> 6] >> (i & 63)) & 1; }
+
+    /* Number of ids in the set; the second form only counts ids below n.
+     */
+    TIDSET_CLONES
+    unsigned int count () const
+    {
+      unsigned int c = 0;
+      for (unsigned int w = 0; w < word_.size (); ++w)
+	c += popcount (word_[w]);
+      return c;
+    }
+    TIDSET_CLONES
+    unsigned int count (unsigned int n) const
+    {
+      unsigned int c = 0;
+      for (unsigned int w = 0; w < n / 64; ++w)
+	c += popcount (word_[w]);
+      if (n % 64)
+	c += popcount (word_[n / 64] & (((uint64_t)1 << (n % 64)) - 1));
+      return c;
+    }
+
+    /* Size of the intersection of a and b, which must have the same size.
+     */
+    TIDSET_CLONES
+    static unsigned int count_and (const TidSet &a, const TidSet &b)
+    {
+      unsigned int c = 0;
+      for (unsigned int w = 0; w < a.word_.size (); ++w)
+	c += popcount (a.word_[w] & b.word_[w]);
+      return c;
+    }
+  };
+
+}
+
+#endif
@@ -40,13 +40,21 @@ int main (int argc, char **argv)
   bool enc = false;
   bool directed = false;
 
-  std::string input_filename = "NCI1_10";
+  // usage: testable [graphs [labels [workers]]], the labels default to
+  // <graphs>_label; with workers, only check that mining on that many
+  // local worker processes gives the result of mining in this one
+  std::string input_filename = argc > 1 ? argv[1] : "data/MUTAG";
 
-  std::ifstream input_f(input_filename);
-  //  std::string input_labels("MUTAG_label");
+  std::string input_labels = argc > 2 ? argv[2] : input_filename + "_label";
   std::ofstream output_f("output");
 
-  GSPAN::gSpan gspan(input_f, output_f, maxpat, minnodes, enc, where, directed);
+  GSPAN::gSpan gspan(input_filename.c_str(), output_f, maxpat, minnodes, enc, where, directed);
+  gspan.read_classes(input_labels.c_str());
+  if (argc > 3) {
+    const bool same = gspan.check_workers(std::stoi(argv[3]), 30);
+    std::cout << "WORKERS: " << (same ? "same result" : "DIFFERENT RESULT") << std::endl;
+    return same ? 0 : 1;
+  }
   // auto res = gspan.run(minsup);
 	 
   namespace th = thesis;
@@ -56,19 +64,25 @@ int main (int argc, char **argv)
 
   auto alpha =  .05;
   
-  auto to_run = [](auto f, auto gspan){return gspan.run(f);};
-  auto to_run_m = [=](auto f, auto pv, auto gspan){return gspan.c_run_m(f,pv,alpha);};
-  auto alg = [=](auto f){ return to_run(f,gspan);};
-  auto alg_m = [=](auto f){return alg(f).size();};
-  auto c_alg_m = [=](auto f, auto pv){return to_run_m(f,pv,gspan);};
+  // one session: every m(f) reruns the same gspan, nothing is copied
+  auto to_run = [](auto f, auto &gspan){return gspan.run(f);};
+  auto to_run_m = [=](auto f, auto pv, auto &gspan){return gspan.c_run_m(f,pv,alpha);};
+  auto alg = [&](auto f){ return to_run(f,gspan);};
+  auto alg_m = [&](auto f){return alg(f).size();};
+  auto c_alg_m = [&](auto f, auto pv){return to_run_m(f,pv,gspan);};
+  auto hist = [&](auto f){return gspan.support_histogram(f);};
+  auto begin_res = [&](auto f){gspan.begin_resume(f);};
+  auto res_m = [&](auto f){return gspan.resume(f);};
 
-  auto n1 = 15u;
-  auto n2 = 44u;
+  auto n1 = gspan.n1();
+  auto n2 = gspan.n2();
 
 
   auto start = std::chrono::system_clock::now();  
 
   auto out = th::one_pass_(alg, n1, n2, alpha);
+  // same root frequency from one counting run, no supports stored:
+  //  auto out = th::lamp_hist_(hist, n1, n2, alpha);
   //  std::cout << "alpha: " << alpha << std::endl;
   //auto out = th::bis_leap_(c_alg_m, n1, n2, alpha);
 
@@ -76,6 +90,8 @@ int main (int argc, char **argv)
   //  std::cout << alg_m(14) << std::endl;
   std::cout << "ROOT FREQ: " << out << std::endl;
   out = th::early_term_(c_alg_m,n1, n2, alpha);
+  // decreasing search over the resumable frontier:
+  // out = th::lamp_dec_(begin_res, res_m, n1, n2, alpha);
 
   auto end = std::chrono::system_clock::now();
   std::chrono::duration<double> diff = end - start;
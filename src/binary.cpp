@@ -0,0 +1,152 @@
+/*
+   Compact binary graph database.
+
+   Layout (native byte order, every array padded to 8 bytes):
+
+     BinaryHeader
+     uint32  vbase[graphs+1]     first vertex of each graph
+     uint32  esize[graphs]       number of edge ids of each graph
+     int32   label[vertices]     vertex labels
+     uint32  offset[vertices+1]  first adjacency entry of each vertex
+     Edge    edge[edges]         adjacency entries, graph-local vertex ids
+
+   The arrays are exactly those of a GraphDB, so a mapped file is used as
+   the database in place, without any deserialization.
+*/
+#include "gspan.h"
+#include <fstream>
+
+#include <stdint.h>
+
+namespace GSPAN {
+
+static const char BINARY_MAGIC[8] = { 'G', 'S', 'P', 'A', 'N', 'D', 'B', '\0' };
+static const uint32_t BINARY_VERSION = 1;
+
+struct BinaryHeader {
+	char     magic[8];
+	uint32_t version;
+	uint32_t directed;
+	uint64_t graphs;
+	uint64_t vertices;
+	uint64_t edges;
+};
+
+static inline uint64_t pad8 (uint64_t n) { return (n + 7) & ~(uint64_t)7; }
+
+static void write_array (std::ostream &os, const void *p, uint64_t n)
+{
+	static const char zero[8] = { 0 };
+	os.write ((const char *)p, n);
+	os.write (zero, pad8 (n) - n);
+}
+
+bool GraphDB::write (const char *filename) const
+{
+	BinaryHeader h;
+	std::memcpy (h.magic, BINARY_MAGIC, sizeof (h.magic));
+	h.version  = BINARY_VERSION;
+	h.directed = directed;
+	h.graphs   = size_;
+	h.vertices = vbase_[size_];
+	h.edges    = offset_[h.vertices];
+
+	std::ofstream os (filename, std::ios::binary);
+	if (! os)
+		return false;
+
+	write_array (os, &h, sizeof (h));
+	write_array (os, vbase_,  (h.graphs + 1)   * sizeof (uint32_t));
+	write_array (os, esize_,  h.graphs         * sizeof (uint32_t));
+	write_array (os, label_,  h.vertices       * sizeof (int32_t));
+	write_array (os, offset_, (h.vertices + 1) * sizeof (uint32_t));
+	write_array (os, edge_,   h.edges          * sizeof (Edge));
+
+	return (bool)os;
+}
+
+/* True if the arrays form a consistent database: the vertex ranges of
+   the graphs and the adjacency ranges of the vertices are monotone and
+   cover the arrays, and every adjacency entry leaves its own vertex
+   towards a vertex of the same graph with an edge id below the graph's
+   count.  O(V + E), so that mining never has to check anything.
+ */
+static bool valid (const BinaryHeader &h, const uint32_t *vbase, const uint32_t *esize,
+		   const uint32_t *offset, const Edge *edge)
+{
+	if (vbase[0] != 0 || vbase[h.graphs] != h.vertices ||
+	    offset[0] != 0 || offset[h.vertices] != h.edges)
+		return false;
+
+	for (uint64_t g = 0; g < h.graphs; ++g) {
+		if (vbase[g] > vbase[g+1])
+			return false;
+		int n = vbase[g+1] - vbase[g];
+
+		for (uint64_t v = vbase[g]; v < vbase[g+1]; ++v) {
+			if (offset[v] > offset[v+1])
+				return false;
+			for (const Edge *e = edge + offset[v]; e != edge + offset[v+1]; ++e)
+				if (e->from != (int)(v - vbase[g]) || e->to < 0 || e->to >= n || e->id >= esize[g])
+					return false;
+		}
+	}
+
+	return true;
+}
+
+bool GraphDB::map (const std::shared_ptr<MappedFile> &file)
+{
+	if (file->size () < sizeof (BinaryHeader) ||
+	    std::memcmp (file->data (), BINARY_MAGIC, sizeof (BINARY_MAGIC)) != 0)
+		return false;
+
+	const BinaryHeader &h = *(const BinaryHeader *)file->data ();
+	if (h.version != BINARY_VERSION) {
+		std::cerr << "Unsupported binary database version " << h.version << std::endl;
+		exit (-1);
+	}
+
+	/* The arrays are indexed with 32 bit ids; larger counts can only come
+	 * from a corrupt header, and would overflow the sizes below.
+	 */
+	if (h.graphs >= 0xffffffff || h.vertices >= 0xffffffff || h.edges >= 0xffffffff) {
+		std::cerr << "Format Error:  corrupt binary database header" << std::endl;
+		exit (-1);
+	}
+
+	const char *p = file->data () + pad8 (sizeof (h));
+	const uint32_t *vbase  = (const uint32_t *)p; p += pad8 ((h.graphs + 1) * sizeof (uint32_t));
+	const uint32_t *esize  = (const uint32_t *)p; p += pad8 (h.graphs * sizeof (uint32_t));
+	const int32_t  *label  = (const int32_t *)p;  p += pad8 (h.vertices * sizeof (int32_t));
+	const uint32_t *offset = (const uint32_t *)p; p += pad8 ((h.vertices + 1) * sizeof (uint32_t));
+	const Edge     *edge   = (const Edge *)p;     p += pad8 (h.edges * sizeof (Edge));
+
+	if (p > file->data () + file->size ()) {
+		std::cerr << "Format Error:  truncated binary database" << std::endl;
+		exit (-1);
+	}
+	if (! valid (h, vbase, esize, offset, edge)) {
+		std::cerr << "Format Error:  corrupt binary database" << std::endl;
+		exit (-1);
+	}
+
+	clear ();
+	file_    = file;
+	vbase_   = vbase;
+	esize_   = esize;
+	label_   = label;
+	offset_  = offset;
+	edge_    = edge;
+	size_    = h.graphs;
+	directed = h.directed;
+
+	return true;
+}
+
+bool gSpan::write (const char *filename)
+{
+	return INPUT.write (filename);
+}
+
+}
@@ -66,6 +66,26 @@ bool DFSCode::toGraph (Graph &g)
 	return (true);
 }
 
+bool DFSCode::toGraph (GraphDB &g)
+{
+	g.clear ();
+
+	for (DFSCode::iterator it = begin(); it != end(); ++it) {
+		g.new_label.resize (std::max (it->from, it->to) + 1);
+
+		if (it->fromlabel != -1)
+			g.new_label[it->from] = it->fromlabel;
+		if (it->tolabel != -1)
+			g.new_label[it->to] = it->tolabel;
+
+		g.push_edge (it->from, it->to, it->elabel);
+	}
+
+	g.end_graph ();
+
+	return (true);
+}
+
 unsigned int
 DFSCode::nodeCount (void)
 {
@@ -0,0 +1,427 @@
+/*
+   Mining on worker processes.
+
+   The coordinator (the gSpan whose run () is called) prepares TRANS and
+   the root table as usual, then hands out the root edges to worker
+   processes over TCP, one at a time, as they finish the previous ones.
+   A worker holds its own copy of the database: on every run it redoes
+   the preprocessing for the minsup of the coordinator, which yields the
+   same TRANS and root table, mines the subtrees of the roots it is sent
+   and answers with their supports.  The coordinator keeps the answers by
+   root and appends them in root order, so run () returns what it would
+   return in one process.  Only the root table and the results ever live
+   in the coordinator; the embeddings below the roots are spread over
+   the workers.
+
+   Messages are arrays of 32 bit words in network byte order:
+
+     setup     MAGIC op minsup maxpat_min maxpat_max graphs n1 roots
+     status    0 (ok) or 1 (the worker has a different database)
+     root      n, or END after the last one
+     result    n count sup[count] sup1[count]
+
+   A setup with op SHUTDOWN makes the worker return from serve ().
+*/
+#include "gspan.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <sys/prctl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+namespace GSPAN {
+
+static const uint32_t MAGIC    = 0x4e505347;	// "GSPN"
+static const uint32_t MINE     = 1;
+static const uint32_t SHUTDOWN = 2;
+static const uint32_t END      = 0xffffffff;
+
+/* Roots in flight per worker, so that a worker does not wait for the
+ * coordinator between two roots.
+ */
+static const unsigned int PIPELINE = 2;
+
+struct Setup {
+	uint32_t magic;
+	uint32_t op;
+	uint32_t minsup;
+	uint32_t maxpat_min;
+	uint32_t maxpat_max;
+	uint32_t graphs;
+	uint32_t n1;
+	uint32_t roots;
+};
+
+static bool send_all (int fd, const void *p, std::size_t n)
+{
+	for (const char *c = (const char *)p; n > 0; ) {
+		ssize_t k = ::send (fd, c, n, MSG_NOSIGNAL);
+		if (k <= 0)
+			return false;
+		c += k;
+		n -= k;
+	}
+	return true;
+}
+
+static bool recv_all (int fd, void *p, std::size_t n)
+{
+	for (char *c = (char *)p; n > 0; ) {
+		ssize_t k = ::recv (fd, c, n, 0);
+		if (k <= 0)
+			return false;
+		c += k;
+		n -= k;
+	}
+	return true;
+}
+
+/* n words w, sent and received in network byte order.
+ */
+static bool send_words (int fd, const uint32_t *w, std::size_t n)
+{
+	std::vector<uint32_t> net (w, w + n);
+	for (std::size_t i = 0; i < n; ++i)
+		net[i] = htonl (net[i]);
+	return send_all (fd, net.data (), n * sizeof (uint32_t));
+}
+
+static bool recv_words (int fd, uint32_t *w, std::size_t n)
+{
+	if (! recv_all (fd, w, n * sizeof (uint32_t)))
+		return false;
+	for (std::size_t i = 0; i < n; ++i)
+		w[i] = ntohl (w[i]);
+	return true;
+}
+
+static const std::size_t SETUP_WORDS = sizeof (Setup) / sizeof (uint32_t);
+
+/* Connected socket to "host:port"; exits on failure.
+ */
+static int connect_to (const std::string &address)
+{
+	std::string::size_type colon = address.rfind (':');
+	if (colon == std::string::npos) {
+		std::cerr << "Bad worker address " << address << " (expected host:port)" << std::endl;
+		exit (-1);
+	}
+	std::string host = address.substr (0, colon), port = address.substr (colon + 1);
+
+	struct addrinfo hints, *res;
+	std::memset (&hints, 0, sizeof (hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	if (getaddrinfo (host.c_str (), port.c_str (), &hints, &res) != 0) {
+		std::cerr << "Cannot resolve worker " << address << std::endl;
+		exit (-1);
+	}
+
+	int fd = -1;
+	for (struct addrinfo *ai = res; ai && fd < 0; ai = ai->ai_next) {
+		fd = socket (ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd >= 0 && connect (fd, ai->ai_addr, ai->ai_addrlen) < 0) {
+			close (fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo (res);
+
+	if (fd < 0) {
+		std::cerr << "Cannot connect to worker " << address << std::endl;
+		exit (-1);
+	}
+
+	int one = 1;
+	setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one));
+	return fd;
+}
+
+/* Listening socket on port (0: any free port) of the interface with
+ * address; exits on failure.
+ */
+static int listen_on (unsigned short port, const std::string &address)
+{
+	struct addrinfo hints, *res;
+	std::memset (&hints, 0, sizeof (hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	hints.ai_flags = AI_PASSIVE;
+	std::string service = std::to_string (port);
+	if (getaddrinfo (address.c_str (), service.c_str (), &hints, &res) != 0) {
+		std::cerr << "Cannot resolve " << address << std::endl;
+		exit (-1);
+	}
+
+	int fd = -1;
+	for (struct addrinfo *ai = res; ai && fd < 0; ai = ai->ai_next) {
+		fd = socket (ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+		if (fd < 0)
+			continue;
+		int one = 1;
+		setsockopt (fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof (one));
+		if (bind (fd, ai->ai_addr, ai->ai_addrlen) < 0 || listen (fd, 16) < 0) {
+			close (fd);
+			fd = -1;
+		}
+	}
+	freeaddrinfo (res);
+
+	if (fd < 0) {
+		std::cerr << "Cannot listen on " << address << " port " << port << std::endl;
+		exit (-1);
+	}
+	return fd;
+}
+
+void gSpan::add_worker (const std::string &address)
+{
+	WORKER_HOSTS.push_back (address);
+}
+
+/* The workers are forked from this process, so they share its database
+ * (including the class order) without reading anything; call after
+ * read_classes ().  They die with the process.
+ */
+void gSpan::fork_workers (unsigned int n)
+{
+	for (unsigned int k = 0; k < n; ++k) {
+		int fd = listen_on (0, "127.0.0.1");
+
+		struct sockaddr_in sa;
+		socklen_t len = sizeof (sa);
+		getsockname (fd, (struct sockaddr *)&sa, &len);
+
+		std::cout.flush ();
+		std::cerr.flush ();
+		pid_t pid = fork ();
+		if (pid < 0) {
+			std::cerr << "Cannot fork worker" << std::endl;
+			exit (-1);
+		}
+		if (pid == 0) {
+			prctl (PR_SET_PDEATHSIG, SIGTERM);
+			threads = std::max (1u, threads / n);
+			WORKER_HOSTS.clear ();
+			WORKER_PIDS.clear ();
+			serve_socket (fd);
+			_exit (0);
+		}
+
+		close (fd);
+		WORKER_PIDS.push_back (pid);
+		WORKER_HOSTS.push_back ("127.0.0.1:" + std::to_string (ntohs (sa.sin_port)));
+	}
+}
+
+void gSpan::stop_workers ()
+{
+	Setup setup;
+	std::memset (&setup, 0, sizeof (setup));
+	setup.magic = MAGIC;
+	setup.op = SHUTDOWN;
+
+	for (unsigned int k = 0; k < WORKER_HOSTS.size (); ++k) {
+		int fd = connect_to (WORKER_HOSTS[k]);
+		send_words (fd, &setup.magic, SETUP_WORDS);
+		close (fd);
+	}
+	for (unsigned int k = 0; k < WORKER_PIDS.size (); ++k)
+		waitpid (WORKER_PIDS[k], 0, 0);
+
+	WORKER_HOSTS.clear ();
+	WORKER_PIDS.clear ();
+}
+
+/* All processes on this host: mine at min_sup here, then on n forked
+ * workers, and compare the supports.  Workers added before are kept
+ * for later runs but not used.
+ */
+bool gSpan::check_workers (unsigned int n, const unsigned min_sup)
+{
+	std::vector<std::string> hosts;
+	std::vector<int> pids;
+	hosts.swap (WORKER_HOSTS);
+	pids.swap (WORKER_PIDS);
+
+	std::vector<unsigned> local = run (min_sup);
+	std::vector<unsigned> local1 = class_results_;
+
+	fork_workers (n);
+	std::vector<unsigned> remote = run (min_sup);
+	bool same = (remote == local && class_results_ == local1);
+	stop_workers ();
+
+	WORKER_HOSTS.swap (hosts);
+	WORKER_PIDS.swap (pids);
+	return same;
+}
+
+void gSpan::serve (unsigned short port, const std::string &address)
+{
+	serve_socket (listen_on (port, address));
+}
+
+void gSpan::serve_socket (int listener)
+{
+	while (true) {
+		int fd = accept (listener, 0, 0);
+		if (fd < 0)
+			continue;
+		int one = 1;
+		setsockopt (fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof (one));
+
+		bool more = serve_connection (fd);
+		close (fd);
+		if (! more)
+			break;
+	}
+	close (listener);
+}
+
+/* One run of a coordinator.  Returns false if asked to shut down.
+ */
+bool gSpan::serve_connection (int fd)
+{
+	Setup setup;
+	if (! recv_words (fd, &setup.magic, SETUP_WORDS) || setup.magic != MAGIC)
+		return true;
+	if (setup.op == SHUTDOWN)
+		return false;
+
+	maxpat_min = setup.maxpat_min;
+	maxpat_max = setup.maxpat_max;
+	reset (setup.minsup);
+	ExtensionTable &root = root_table ();
+
+	uint32_t status = (setup.graphs != TRANS.size () || setup.n1 != n1_ || setup.roots != root.size ());
+	if (! send_words (fd, &status, 1) || status)
+		return true;
+
+	std::vector<uint32_t> reply;
+	for (uint32_t n; recv_words (fd, &n, 1) && n < root.size (); ) {
+		results_.clear ();
+		class_results_.clear ();
+
+		DFS_CODE.push (0, 1, root.fromlabel (n), root.elabel (n), root.tolabel (n));
+		Projected projected = root[n];
+		project (projected);
+		DFS_CODE.pop ();
+
+		reply.assign (1, n);
+		reply.push_back (results_.size ());
+		reply.insert (reply.end (), results_.begin (), results_.end ());
+		reply.insert (reply.end (), class_results_.begin (), class_results_.end ());
+		if (! send_words (fd, reply.data (), reply.size ()))
+			break;
+	}
+
+	results_.clear ();
+	class_results_.clear ();
+	return true;
+}
+
+/* Mine the subtrees of the sorted root table on the workers.
+ */
+void gSpan::project_remote (ExtensionTable &root)
+{
+	unsigned int workers = WORKER_HOSTS.size ();
+
+	Setup setup;
+	setup.magic      = MAGIC;
+	setup.op         = MINE;
+	setup.minsup     = minsup;
+	setup.maxpat_min = maxpat_min;
+	setup.maxpat_max = maxpat_max;
+	setup.graphs     = TRANS.size ();
+	setup.n1         = n1_;
+	setup.roots      = root.size ();
+
+	std::vector<int> fd (workers);
+	for (unsigned int k = 0; k < workers; ++k) {
+		fd[k] = connect_to (WORKER_HOSTS[k]);
+		if (! send_words (fd[k], &setup.magic, SETUP_WORDS)) {
+			std::cerr << "Lost connection to worker " << WORKER_HOSTS[k] << std::endl;
+			exit (-1);
+		}
+	}
+	for (unsigned int k = 0; k < workers; ++k) {
+		uint32_t status;
+		if (! recv_words (fd[k], &status, 1) || status) {
+			std::cerr << "Worker " << WORKER_HOSTS[k] << " does not hold the same database" << std::endl;
+			exit (-1);
+		}
+	}
+
+	std::vector<std::vector<unsigned> > results (root.size ()), class_results (root.size ());
+	std::vector<unsigned int> inflight (workers, 0);
+	unsigned int next = 0, done = 0;
+
+	/* Keep every worker PIPELINE roots ahead, and collect the answers as
+	 * they come.
+	 */
+	while (done < root.size ()) {
+		for (unsigned int k = 0; k < workers; ++k)
+			for (; inflight[k] < PIPELINE && next < root.size (); ++next, ++inflight[k])
+				if (! send_words (fd[k], &next, 1)) {
+					std::cerr << "Lost connection to worker " << WORKER_HOSTS[k] << std::endl;
+					exit (-1);
+				}
+
+		std::vector<struct pollfd> pfd (workers);
+		for (unsigned int k = 0; k < workers; ++k) {
+			pfd[k].fd = inflight[k] ? fd[k] : -1;
+			pfd[k].events = POLLIN;
+			pfd[k].revents = 0;
+		}
+		if (poll (pfd.data (), workers, -1) < 0)
+			continue;
+
+		for (unsigned int k = 0; k < workers; ++k) {
+			if (! pfd[k].revents)
+				continue;
+
+			uint32_t head[2];
+			if (! recv_words (fd[k], head, 2) || head[0] >= root.size ()) {
+				std::cerr << "Lost connection to worker " << WORKER_HOSTS[k] << std::endl;
+				exit (-1);
+			}
+			results[head[0]].resize (head[1]);
+			class_results[head[0]].resize (head[1]);
+			if (! recv_words (fd[k], results[head[0]].data (), head[1]) ||
+			    ! recv_words (fd[k], class_results[head[0]].data (), head[1])) {
+				std::cerr << "Lost connection to worker " << WORKER_HOSTS[k] << std::endl;
+				exit (-1);
+			}
+			--inflight[k];
+			++done;
+		}
+	}
+
+	for (unsigned int k = 0; k < workers; ++k) {
+		send_words (fd[k], &END, 1);
+		close (fd[k]);
+	}
+
+	for (unsigned int n = 0; n < root.size (); ++n) {
+		if (counting) {
+			for (unsigned int i = 0; i < results[n].size (); ++i)
+				record (results[n][i], class_results[n][i]);
+			ID += results[n].size ();
+			continue;
+		}
+		results_.insert (results_.end (), results[n].begin (), results[n].end ());
+		class_results_.insert (class_results_.end (), class_results[n].begin (), class_results[n].end ());
+		ID += results[n].size ();
+	}
+}
+
+}
@@ -0,0 +1,157 @@
+/*
+   Flat extension table (see ExtensionTable in gspan.h).
+
+   The candidate extensions of a pattern used to be collected in nested
+   std::map's keyed by from, elabel and tolabel, costing three tree lookups
+   and possibly three node allocations for every embedding.  Here every
+   embedding costs one hash probe and an append, and the groups are put in
+   DFS code order by a counting sort once enumeration is done.
+*/
+#include "gspan.h"
+#include "parallel.h"
+
+namespace GSPAN {
+
+static const unsigned int EMPTY = 0xffffffff;
+
+static inline unsigned int hash (uint64_t key)
+{
+	key *= 0x9e3779b97f4a7c15ULL;
+	return (unsigned int)(key >> 32);
+}
+
+void ExtensionTable::clear ()
+{
+	pdfs_.clear ();
+	slot_.clear ();
+	group_.clear ();
+	alive_.clear ();
+	start_.clear ();
+	filter_ = Filter ();
+
+	/* Only the slots in use are emptied, so that a small table entered
+	 * after a large one does not pay for the size of the hash.
+	 */
+	for (unsigned int i = 0; i < hused_.size (); ++i)
+		hgroup_[hused_[i]] = EMPTY;
+	hused_.clear ();
+}
+
+/* Group of key, created if new.  The hash is kept at most half full.
+ */
+unsigned int ExtensionTable::insert (uint64_t key)
+{
+	if (2 * (group_.size () + 1) > hkey_.size ()) {
+		unsigned int n = hkey_.empty () ? 16 : 2 * hkey_.size ();
+		hkey_.assign (n, 0);
+		hgroup_.assign (n, EMPTY);
+		hused_.clear ();
+		for (unsigned int g = 0; g < group_.size (); ++g) {
+			unsigned int h = hash (group_[g]) & (n - 1);
+			while (hgroup_[h] != EMPTY)
+				h = (h + 1) & (n - 1);
+			hkey_[h] = group_[g];
+			hgroup_[h] = g;
+			hused_.push_back (h);
+		}
+	}
+
+	unsigned int mask = hkey_.size () - 1;
+	unsigned int h = hash (key) & mask;
+	for (; hgroup_[h] != EMPTY; h = (h + 1) & mask)
+		if (hkey_[h] == key)
+			return hgroup_[h];
+
+	hkey_[h] = key;
+	hgroup_[h] = group_.size ();
+	hused_.push_back (h);
+	group_.push_back (key);
+	alive_.push_back (! filter_ || filter_ (key));
+
+	return hgroup_[h];
+}
+
+void ExtensionTable::sort ()
+{
+	unsigned int groups = group_.size ();
+
+	/* Rank the accepted groups by key.
+	 */
+	order_.clear ();
+	for (unsigned int g = 0; g < groups; ++g)
+		if (alive_[g])
+			order_.push_back (g);
+	groups = order_.size ();
+	std::sort (order_.begin (), order_.end (),
+		   [this] (unsigned int a, unsigned int b) { return group_[a] < group_[b]; });
+
+	sorted_key_.resize (groups);
+	rank_.resize (group_.size ());
+	for (unsigned int r = 0; r < groups; ++r) {
+		sorted_key_[r] = group_[order_[r]];
+		rank_[order_[r]] = r;
+	}
+
+	/* Counting sort of the embeddings by group rank; stable, so every
+	 * group keeps the push order.
+	 */
+	start_.assign (groups + 1, 0);
+	for (unsigned int i = 0; i < slot_.size (); ++i)
+		++start_[rank_[slot_[i]] + 1];
+	for (unsigned int r = 0; r < groups; ++r)
+		start_[r+1] += start_[r];
+
+	order_.assign (start_.begin (), start_.end () - 1);
+	sorted_.resize (pdfs_.size ());
+	for (unsigned int i = 0; i < slot_.size (); ++i)
+		sorted_[order_[rank_[slot_[i]]]++] = pdfs_[i];
+
+	pdfs_.swap (sorted_);
+	group_.swap (sorted_key_);
+}
+
+void ExtensionTable::merge (const std::vector<const ExtensionTable *> &part, unsigned int threads)
+{
+	group_.clear ();
+	for (unsigned int p = 0; p < part.size (); ++p)
+		group_.insert (group_.end (), part[p]->group_.begin (), part[p]->group_.end ());
+	std::sort (group_.begin (), group_.end ());
+	group_.erase (std::unique (group_.begin (), group_.end ()), group_.end ());
+
+	/* order_ gets the destination of every group of every part, in part
+	 * order, so that the parts can be copied independently.
+	 */
+	start_.assign (group_.size () + 1, 0);
+	std::vector<unsigned int> first (part.size () + 1, 0);
+	for (unsigned int p = 0; p < part.size (); ++p) {
+		first[p+1] = first[p] + part[p]->size ();
+		for (unsigned int g = 0; g < part[p]->size (); ++g) {
+			unsigned int r = std::lower_bound (group_.begin (), group_.end (), part[p]->group_[g]) - group_.begin ();
+			start_[r+1] += part[p]->start_[g+1] - part[p]->start_[g];
+		}
+	}
+	for (unsigned int r = 0; r < group_.size (); ++r)
+		start_[r+1] += start_[r];
+
+	rank_.assign (start_.begin (), start_.end () - 1);
+	order_.resize (first[part.size ()]);
+	for (unsigned int p = 0; p < part.size (); ++p)
+		for (unsigned int g = 0; g < part[p]->size (); ++g) {
+			unsigned int r = std::lower_bound (group_.begin (), group_.end (), part[p]->group_[g]) - group_.begin ();
+			order_[first[p] + g] = rank_[r];
+			rank_[r] += part[p]->start_[g+1] - part[p]->start_[g];
+		}
+
+	pdfs_.resize (start_[group_.size ()]);
+	parallel_for (part.size (), threads, [&] (unsigned int p, unsigned int) {
+			const ExtensionTable &t = *part[p];
+			for (unsigned int g = 0; g < t.size (); ++g)
+				std::copy (t.pdfs_.begin () + t.start_[g], t.pdfs_.begin () + t.start_[g+1],
+					   pdfs_.begin () + order_[first[p] + g]);
+		});
+
+	slot_.clear ();
+	alive_.assign (group_.size (), 1);
+}
+
+}
@@ -0,0 +1,153 @@
+/*
+   Resumable mining for decreasing support thresholds.
+
+   lamp_dec_ style searches mine at f, f-1, f-2, ... and every run used to
+   explore again everything the previous one had.  Here the database is
+   preprocessed once for the lowest threshold (the floor), so that TRANS,
+   the label ranks and the extension filter stay the same for all the
+   runs, and project () does not drop a pattern that is frequent at the
+   floor but below the current threshold: it keeps it in FRONTIER, with
+   its support and a flattened copy of its embeddings.  The next run at a
+   lower threshold mines just the frontier patterns that reached it, from
+   their stored embeddings, and adds what it finds to the earlier results.
+   Over the whole search every pattern is visited about once, as in a
+   single run at the final threshold.
+
+   early_term_ style searches go the other way: c_run_m () at f, f+1, ...
+   where every run stops once it has found enough patterns.  When a run
+   stops, the extensions it has not explored yet go to FRONTIER instead
+   of being dropped.  A pattern of support >= f+1 is then either among
+   the results found so far or below one of them, so the next run keeps
+   the results that reach f+1 and only mines the frontier, at f+1.  The
+   database stays prepared for the first threshold, which is lower.
+*/
+#include "gspan.h"
+
+namespace GSPAN {
+
+/* Support of frontier entries not counted yet (the roots).
+ */
+static const unsigned int UNKNOWN = 0xffffffff;
+
+void gSpan::begin_resume (const unsigned floor)
+{
+	if (boost) {
+		std::cerr << "Resumable mining does not support boosting" << std::endl;
+		exit (-1);
+	}
+
+	reset (floor);
+	resuming = true;
+	threshold = UNKNOWN;
+
+	if (maxpat_min <= 1)
+		count_single_vertices ();
+
+	/* The roots are the initial frontier.
+	 */
+	ExtensionTable &root = root_table ();
+	for (unsigned int n = 0; n < root.size (); ++n) {
+		DFS_CODE.push (0, 1, root.fromlabel (n), root.elabel (n), root.tolabel (n));
+		FRONTIER.push_back (FrontierEntry ());
+		FRONTIER.back ().sup = UNKNOWN;
+		flatten (root[n], FRONTIER.back ().flat);
+		FRONTIER.back ().code = DFS_CODE;
+		DFS_CODE.pop ();
+	}
+}
+
+std::size_t gSpan::resume (const unsigned min_sup)
+{
+	if (! resuming || min_sup < minsup || min_sup > threshold) {
+		std::cerr << "resume (" << min_sup << "): thresholds must not increase and not go below "
+			  << "the floor given to begin_resume ()" << std::endl;
+		exit (-1);
+	}
+
+	/* Single vertex patterns that reached min_sup.
+	 */
+	for (std::map<unsigned int, unsigned int>::iterator it = singleVertexLabel.begin ();
+	     it != singleVertexLabel.end (); ++it) {
+		if (it->second < min_sup || it->second >= threshold)
+			continue;
+
+		Graph g (directed);
+		g.resize (1);
+		g[0].label = it->first;
+
+		std::map<unsigned int, unsigned int> gycounts;
+		for (unsigned int n = 0; n < TRANS.size (); ++n)
+			gycounts[input_id (n)] = singleVertex[n][it->first];
+		report_single (g, gycounts);
+	}
+
+	/* The frontier patterns that reached min_sup are mined; the others,
+	 * and the patterns pruned now, form the new frontier.
+	 */
+	threshold = min_sup;
+	std::vector<FrontierEntry> todo;
+	todo.swap (FRONTIER);
+
+	for (unsigned int i = 0; i < todo.size (); ++i) {
+		if (todo[i].sup < min_sup) {
+			FRONTIER.push_back (std::move (todo[i]));
+			continue;
+		}
+
+		Projected projected = unflatten (todo[i].code, todo[i].flat);
+		project (projected);
+		DFS_CODE.clear ();
+		std::vector<PDFS> ().swap (todo[i].flat);
+	}
+
+	return results_.size ();
+}
+
+/* Keep child, the projection of DFS_CODE, for a later run.
+ */
+void gSpan::postpone (const Projected &child)
+{
+	FRONTIER.push_back (FrontierEntry ());
+	FRONTIER.back ().code = DFS_CODE;
+	FRONTIER.back ().sup = UNKNOWN;
+	flatten (child, FRONTIER.back ().flat);
+}
+
+std::size_t gSpan::resume_early (const unsigned min_sup, double min_pv, double alpha)
+{
+	/* Only the results that reach min_sup still count.
+	 */
+	std::size_t kept = 0;
+	for (std::size_t i = 0; i < results_.size (); ++i)
+		if (results_[i] >= min_sup) {
+			results_[kept] = results_[i];
+			class_results_[kept] = class_results_[i];
+			++kept;
+		}
+	results_.resize (kept);
+	class_results_.resize (kept);
+
+	unsigned int floor = minsup;	// what TRANS was built for
+	minsup = threshold = min_sup;
+	terminated = (results_.size () * min_pv > alpha);
+
+	std::vector<FrontierEntry> todo;
+	todo.swap (FRONTIER);
+
+	for (unsigned int i = 0; i < todo.size (); ++i) {
+		if (terminated) {
+			FRONTIER.push_back (std::move (todo[i]));
+			continue;
+		}
+
+		Projected projected = unflatten (todo[i].code, todo[i].flat);
+		project (projected, min_pv, alpha);
+		DFS_CODE.clear ();
+		std::vector<PDFS> ().swap (todo[i].flat);
+	}
+
+	minsup = floor;
+	return results_.size ();
+}
+
+}
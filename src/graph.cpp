@@ -20,101 +20,50 @@
      02111-1307, USA
 */
 #include "gspan.h"
-#include <cstring>
 #include <string>
-#include <iterator>
-#include <strstream>
 #include <set>
 
 #include <assert.h>
 
 namespace GSPAN {
 
-template <class T, class Iterator>
-void tokenize (const char *str, Iterator iterator)
+/* Return the first edge of [first, last) going to `to' with label elabel,
+   or 0.
+ */
+static inline const Edge *find_edge (const Edge *first, const Edge *last, int to, int elabel)
 {
-	std::istrstream is (str, std::strlen(str));
-	std::copy (std::istream_iterator <T> (is), std::istream_iterator <T> (), iterator);
+	for (; first != last; ++first)
+		if (first->to == to && first->elabel == elabel)
+			return first;
+	return 0;
 }
 
+/* Assign unique id's for the edges.  Two entries share an id when they
+   describe the same (from, to, elabel) edge, with from <= to in the
+   undirected case.  The id is derived from the adjacency lists alone: an
+   undirected edge seen from its larger endpoint takes the id of its twin,
+   numbered while scanning the smaller endpoint, and parallel entries reuse
+   the id of the first one.  No allocation is needed.
+ */
 void Graph::buildEdge ()
 {
-	char buf[512];
-	std::map <std::string, unsigned int> tmp;
-
 	unsigned int id = 0;
 	for (int from = 0; from < (int)size (); ++from) {
-		for (Vertex::edge_iterator it = (*this)[from].edge.begin ();
-				it != (*this)[from].edge.end (); ++it)
-		{
-			if (directed || from <= it->to)
-				std::sprintf (buf, "%d %d %d", from, it->to, it->elabel);
-			else
-				std::sprintf (buf, "%d %d %d", it->to, from, it->elabel);
-
-			// Assign unique id's for the edges.
-			if (tmp.find (buf) == tmp.end()) {
-				it->id = id;
-				tmp[buf] = id;
-				++id;
-			} else {
-				it->id = tmp[buf];
+		std::vector<Edge> &edge = (*this)[from].edge;
+		for (unsigned int i = 0; i < edge.size (); ++i) {
+			const Edge *twin = 0;
+			if (! directed && from > edge[i].to) {
+				std::vector<Edge> &back = (*this)[edge[i].to].edge;
+				twin = find_edge (back.data (), back.data () + back.size (), from, edge[i].elabel);
 			}
-		}
-	}
-
-	edge_size_ = id;
-}
-
-std::istream &Graph::read (std::istream &is)
-{
-	std::vector <std::string> result;
-	char line[1024];
-
-	clear ();
+			if (! twin)
+				twin = find_edge (edge.data (), edge.data () + i, edge[i].to, edge[i].elabel);
 
-	while (true) {
-
-		unsigned int pos = is.tellg ();
-		if (! is.getline (line, 1024))
-			break;
-		result.clear ();
-		tokenize<std::string>(line, std::back_inserter (result));
-
-		if (result.empty()) {
-			// do nothing
-		} else if (result[0] == "t") {
-			if (! empty()) { // use as delimiter
-				is.seekg (pos, std::ios_base::beg);
-				break;
-			} else {
-				/*
-				 * y = atoi (result[3].c_str());
-				 */
-			}
-		} else if (result[0] == "v" && result.size() >= 3) {
-			unsigned int id    = atoi (result[1].c_str());
-			this->resize (id + 1);
-			(*this)[id].label = atoi (result[2].c_str());
-		} else if (result[0] == "e" && result.size() >= 4) {
-			int from   = atoi (result[1].c_str());
-			int to     = atoi (result[2].c_str());
-			int elabel = atoi (result[3].c_str());
-
-			if ((int)size () <= from || (int)size () <= to) {
-				std::cerr << "Format Error:  define vertex lists before edges" << std::endl;
-				exit (-1);
-			}
-
-			(*this)[from].push (from, to, elabel);
-			if (directed == false)
-				(*this)[to].push (to, from, elabel);
+			edge[i].id = twin ? twin->id : id++;
 		}
 	}
 
-	buildEdge ();
-
-	return is;
+	edge_size_ = id;
 }
 
 std::ostream &Graph::write (std::ostream &os)
@@ -158,5 +107,168 @@ void Graph::check (void)
 	}
 }
 
+GraphDB::GraphDB (bool _directed): directed(_directed)
+{
+	clear ();
+}
+
+GraphDB::GraphDB (const GraphDB &g):
+	store_(g.store_), file_(g.file_),
+	vbase_(g.vbase_), esize_(g.esize_), label_(g.label_), offset_(g.offset_), edge_(g.edge_),
+	size_(g.size_), directed(g.directed)
+{
+	if (g.owned ())
+		repoint ();
+}
+
+GraphDB &GraphDB::operator= (const GraphDB &g)
+{
+	store_ = g.store_;
+	file_ = g.file_;
+	vbase_ = g.vbase_; esize_ = g.esize_; label_ = g.label_; offset_ = g.offset_; edge_ = g.edge_;
+	size_ = g.size_;
+	directed = g.directed;
+	if (g.owned ())
+		repoint ();
+	return *this;
+}
+
+void GraphDB::clear ()
+{
+	file_.reset ();
+	store_.vbase.assign (1, 0);
+	store_.esize.clear ();
+	store_.label.clear ();
+	store_.offset.assign (1, 0);
+	store_.edge.clear ();
+	new_label.clear ();
+	new_edge.clear ();
+	repoint ();
+}
+
+void GraphDB::repoint ()
+{
+	vbase_  = store_.vbase.data ();
+	esize_  = store_.esize.data ();
+	label_  = store_.label.data ();
+	offset_ = store_.offset.data ();
+	edge_   = store_.edge.data ();
+	size_   = store_.esize.size ();
+}
+
+/* Copy borrowed arrays into store_ before modifying them.
+ */
+void GraphDB::own ()
+{
+	if (owned ())
+		return;
+
+	unsigned int vertices = vbase_[size_];
+	store_.vbase.assign (vbase_, vbase_ + size_ + 1);
+	store_.esize.assign (esize_, esize_ + size_);
+	store_.label.assign (label_, label_ + vertices);
+	store_.offset.assign (offset_, offset_ + vertices + 1);
+	store_.edge.assign (edge_, edge_ + offset_[vertices]);
+	file_.reset ();
+	repoint ();
+}
+
+void GraphDB::borrow (const GraphDB &g)
+{
+	clear ();
+	file_    = g.file_;
+	vbase_   = g.vbase_;
+	esize_   = g.esize_;
+	label_   = g.label_;
+	offset_  = g.offset_;
+	edge_    = g.edge_;
+	size_    = g.size_;
+	directed = g.directed;
+}
+
+/* Append all graphs of g.
+ */
+void GraphDB::append (const GraphDB &g)
+{
+	own ();
+
+	unsigned int vb = store_.label.size ();
+	unsigned int eb = store_.edge.size ();
+	unsigned int vertices = g.vbase_[g.size_];
+
+	for (unsigned int id = 0; id < g.size_; ++id)
+		store_.vbase.push_back (vb + g.vbase_[id+1]);
+	store_.esize.insert (store_.esize.end (), g.esize_, g.esize_ + g.size_);
+	store_.label.insert (store_.label.end (), g.label_, g.label_ + vertices);
+	for (unsigned int v = 0; v < vertices; ++v)
+		store_.offset.push_back (eb + g.offset_[v+1]);
+	store_.edge.insert (store_.edge.end (), g.edge_, g.edge_ + g.offset_[vertices]);
+
+	repoint ();
+}
+
+/* Append a copy of g.
+ */
+void GraphDB::push (const GraphRef &g)
+{
+	own ();
+
+	for (unsigned int v = 0; v < g.size (); ++v) {
+		store_.label.push_back (g.label (v));
+		store_.edge.insert (store_.edge.end (), g.begin (v), g.end (v));
+		store_.offset.push_back (store_.edge.size ());
+	}
+	store_.vbase.push_back (store_.label.size ());
+	store_.esize.push_back (g.edge_size ());
+
+	repoint ();
+}
+
+/* Append the graph in new_label/new_edge.  The entries are counting-sorted
+   by source vertex, keeping their insertion order within one vertex, and
+   numbered as in Graph::buildEdge.
+ */
+void GraphDB::end_graph ()
+{
+	own ();
+
+	unsigned int n  = new_label.size ();
+	unsigned int vb = store_.label.size ();
+	unsigned int eb = store_.edge.size ();
+
+	store_.label.insert (store_.label.end (), new_label.begin (), new_label.end ());
+
+	store_.offset.resize (vb + n + 1, 0);
+	for (unsigned int i = 0; i < new_edge.size (); ++i)
+		++store_.offset[vb + new_edge[i].from + 1];
+	for (unsigned int v = 0; v < n; ++v)
+		store_.offset[vb + v + 1] += store_.offset[vb + v];
+
+	cursor_.assign (store_.offset.begin () + vb, store_.offset.begin () + vb + n);
+	store_.edge.resize (eb + new_edge.size ());
+	for (unsigned int i = 0; i < new_edge.size (); ++i)
+		store_.edge[cursor_[new_edge[i].from]++] = new_edge[i];
+
+	const unsigned int *offset = store_.offset.data () + vb;
+	Edge *edge = store_.edge.data ();
+	unsigned int id = 0;
+	for (int from = 0; from < (int)n; ++from) {
+		for (Edge *e = edge + offset[from]; e != edge + offset[from+1]; ++e) {
+			const Edge *twin = 0;
+			if (! directed && from > e->to)
+				twin = find_edge (edge + offset[e->to], edge + offset[e->to + 1], from, e->elabel);
+			if (! twin)
+				twin = find_edge (edge + offset[from], e, e->to, e->elabel);
+
+			e->id = twin ? twin->id : id++;
+		}
+	}
+
+	store_.esize.push_back (id);
+	store_.vbase.push_back (vb + n);
+	new_label.clear ();
+	new_edge.clear ();
+	repoint ();
 }
 
+}
@@ -20,6 +20,8 @@
   02111-1307, USA
 */
 #include "gspan.h"
+#include "parallel.h"
+#include "fisher.hpp"
 #include <iterator>
 
 #include <stdlib.h>
@@ -32,6 +34,26 @@ namespace GSPAN {
 		bool _enc,
 		bool _where,
 		bool _directed) 
+  {
+    init (_os, _maxpat_min, _maxpat_max, _enc, _where, _directed);
+    read (is);
+  }
+
+  gSpan::gSpan (const char *filename, std::ostream &_os,
+		unsigned int _maxpat_min, unsigned int _maxpat_max,
+		bool _enc,
+		bool _where,
+		bool _directed) 
+  {
+    init (_os, _maxpat_min, _maxpat_max, _enc, _where, _directed);
+    read (filename);
+  }
+
+  void gSpan::init (std::ostream &_os,
+		    unsigned int _maxpat_min, unsigned int _maxpat_max,
+		    bool _enc,
+		    bool _where,
+		    bool _directed)
   {
     os = &_os;
     ID = 0;
@@ -40,19 +62,27 @@ namespace GSPAN {
     enc = _enc;
     where = _where;
     directed = _directed;
+    threads = default_threads ();
     boost = false;
-
-    read (is);
+    n1_ = n2_ = 0;
+    POOL = 0;
+    TASK = 0;
+    WORKER = 0;
+    terminated = false;
+    prepared = false;
+    counting = false;
+    threshold = 0;
+    resuming = false;
+    early = false;
+    LAMP = 0;
+    WY = 0;
   }
 
   std::istream &gSpan::read (std::istream &is)
   {
-    Graph g(directed);
-    while (true) {
-      g.read (is);
-      if (g.empty()) break;
-      TRANS.push_back (g);
-    }
+    std::string buf ((std::istreambuf_iterator<char> (is)),
+		     std::istreambuf_iterator<char> ());
+    read_text (buf.data (), buf.size ());
     return is;
   }
 
@@ -216,20 +246,49 @@ namespace GSPAN {
   }
 
 
+  /* Number of graphs the pattern occurs in, whatever the order of the
+   * embeddings; tids receives those graphs and sup1 the number of them in
+   * the first class, which occupies ids [0, n1).
+   */
   unsigned int
-  gSpan::support (Projected &projected)
+  gSpan::support (Projected &projected, TidSet &tids, unsigned int &sup1)
   {
-    unsigned int oid = 0xffffffff;
-    unsigned int size = 0;
+    tids.reset (TRANS.size ());
+    for (Projected::iterator cur = projected.begin(); cur != projected.end(); ++cur)
+      tids.set (cur->id);
 
-    for (Projected::iterator cur = projected.begin(); cur != projected.end(); ++cur) {
-      if (oid != cur->id) {
-	++size;
-      }
-      oid = cur->id;
+    sup1 = tids.count (n1_);
+    return tids.count ();
+  }
+
+  /* Filter of the extension tables: an extension along an edge whose
+   * (fromlabel, elabel, tolabel) triple occurs in fewer than minsup of the
+   * graphs of the current pattern cannot be frequent.  PATTERN_LABEL,
+   * PATTERN_TIDS and PATTERN_MAXTOC describe the pattern being extended.
+   */
+  bool gSpan::frequent_extension (uint64_t key)
+  {
+    int from, to;
+    if (ExtensionTable::is_forward (key)) {
+      from = ExtensionTable::MAXID - ExtensionTable::field (key, 0);
+      to = -1;
+    } else {
+      from = PATTERN_MAXTOC;
+      to = ExtensionTable::field (key, 0);
     }
 
-    return size;
+    int elabel = ExtensionTable::field (key, 1);
+    int tolabel = to < 0 ? ExtensionTable::field (key, 2) : PATTERN_LABEL[to];
+    const TidSet *t = triple_tids (PATTERN_LABEL[from], elabel, tolabel);
+
+    return ! t || TidSet::count_and (*PATTERN_TIDS, *t) >= minsup;
+  }
+
+  TidSet &gSpan::tids_at (unsigned int depth)
+  {
+    if (TIDS.size () <= depth)
+      TIDS.resize (depth + 1);
+    return TIDS[depth];
   }
 
   void gSpan::report_boosting (Projected &projected, unsigned int sup,
@@ -242,15 +301,17 @@ namespace GSPAN {
 
     Graph g(directed);
     DFS_CODE.toGraph (g);
+    restore_labels (g);
 
     // insert individual counts
     std::map<unsigned int, unsigned int> GYcounts;
     unsigned int oid = 0xffffffff;
     for (Projected::iterator cur = projected.begin(); cur != projected.end(); ++cur) {
+      unsigned int id = input_id (cur->id);
       if (oid != cur->id)
-	GYcounts[cur->id] = 0;
+	GYcounts[id] = 0;
 
-      GYcounts[cur->id] += 1;
+      GYcounts[id] += 1;
       oid = cur->id;
     }
 
@@ -294,10 +355,14 @@ namespace GSPAN {
   void gSpan::report_single (Graph &g, std::map<unsigned int, unsigned int>& ncount)
   {
     unsigned int sup = 0;
+    unsigned int sup1 = 0;
+    unsigned int graphs = 0;
     for (std::map<unsigned int, unsigned int>::iterator it = ncount.begin () ;
 	 it != ncount.end () ; ++it)
       {
 	sup += (*it).second;
+	sup1 += ((*it).first < n1_ && (*it).second > 0);
+	graphs += ((*it).second > 0);
       }
 
     if (maxpat_max > maxpat_min && g.size () > maxpat_max)
@@ -305,7 +370,12 @@ namespace GSPAN {
     if (maxpat_min > 0 && g.size () < maxpat_min)
       return;
 
-    results_.push_back(sup);
+    /* The pattern is recorded with the number of graphs it occurs in,
+     * like the larger ones: that decides whether it is frequent, and sup1
+     * counts graphs too, so it is what the pattern is tested with.  The
+     * output keeps the number of occurrences, sup.
+     */
+    record (graphs, sup1);
     if (enc == false) {
       if (where == false)
 	*os << "t # " << ID << " * " << sup;
@@ -320,9 +390,9 @@ namespace GSPAN {
   }
 
 
-  void gSpan::report (Projected &projected, unsigned int sup)
+  void gSpan::report (Projected &projected, unsigned int sup, unsigned int sup1)
   {
-    results_.push_back(sup);
+    record (sup, sup1);
 
     //    std::cout << ID << std::endl;
     ++ID;
@@ -377,6 +447,120 @@ namespace GSPAN {
   /* Recursive subgraph mining function (similar to subprocedure 1
    * Subgraph_Mining in [Yan2002]).
    */
+  /* Smallest projection whose extensions are collected on several
+   * threads, and smallest slice of it handed to one thread.
+   */
+  static const unsigned int PARALLEL_EMBEDDINGS = 1 << 14;
+  static const unsigned int SLICE_EMBEDDINGS    = 1 << 12;
+
+  /* Collect the extensions of the embeddings [begin, end) of projected,
+   * which is the projection of DFS_CODE, into extensions.
+   */
+  void gSpan::enumerate (Projected &projected, unsigned int begin, unsigned int end, const RMPath &rmpath,
+			 ExtensionTable &extensions, History &history, EdgeList &edges)
+  {
+    int minlabel = DFS_CODE[0].fromlabel;
+    int maxtoc = DFS_CODE[rmpath[0]].to;
+
+    history.restart ();
+    for (unsigned int n = begin; n < end; ++n) {
+
+      unsigned int id = projected[n].id;
+      unsigned int cur = projected.index (n);
+      GraphRef g = TRANS[id];
+      history.build (g, LEVEL, DFS_CODE.size (), cur);	// incremental over the siblings of cur
+
+      // XXX: do we have to change something here for directed edges?
+
+      // backward
+      for (int i = (int)rmpath.size()-1; i >= 1; --i) {
+	const Edge *e = get_backward (g, history[rmpath[i]], history[rmpath[0]], history);
+	if (e)
+	  extensions.push (ExtensionTable::backward (DFS_CODE[rmpath[i]].from, e->elabel), id, g.index (e), cur);
+      }
+
+      // pure forward
+      // FIXME: here we pass a too large e->to (== history[rmpath[0]]->to
+      // into get_forward_pure, such that the assertion fails.
+      //
+      // The problem is:
+      // history[rmpath[0]]->to > TRANS[id].size()
+      if (get_forward_pure (g, history[rmpath[0]], minlabel, history, edges))
+	for (EdgeList::iterator it = edges.begin(); it != edges.end(); ++it)
+	  extensions.push (ExtensionTable::forward (maxtoc, (*it)->elabel, g.label ((*it)->to)), id, g.index (*it), cur);
+
+      // backtracked forward
+      for (int i = 0; i < (int)rmpath.size(); ++i)
+	if (get_forward_rmpath (g, history[rmpath[i]], minlabel, history, edges))
+	  for (EdgeList::iterator it = edges.begin(); it != edges.end();  ++it)
+	    extensions.push (ExtensionTable::forward (DFS_CODE[rmpath[i]].from, (*it)->elabel, g.label ((*it)->to)),
+			     id, g.index (*it), cur);
+    }
+  }
+
+  /* Sorted table of the frequent-looking extensions of DFS_CODE, whose
+   * projection is projected and whose graphs are tids.  Large projections
+   * are cut into slices at graph boundaries; every slice is enumerated and
+   * sorted on its own thread, and the slices are merged in key order.
+   * Every key gets its embeddings in the same order either way.
+   */
+  ExtensionTable &gSpan::enumerate (Projected &projected, TidSet &tids, const RMPath &rmpath)
+  {
+    int maxtoc = DFS_CODE[rmpath[0]].to;
+
+    PATTERN_LABEL.assign (maxtoc + 1, -1);
+    for (unsigned int i = 0; i < DFS_CODE.size (); ++i) {
+      if (DFS_CODE[i].fromlabel != -1)
+	PATTERN_LABEL[DFS_CODE[i].from] = DFS_CODE[i].fromlabel;
+      if (DFS_CODE[i].tolabel != -1)
+	PATTERN_LABEL[DFS_CODE[i].to] = DFS_CODE[i].tolabel;
+    }
+    PATTERN_TIDS = &tids;
+    PATTERN_MAXTOC = maxtoc;
+    ExtensionTable::Filter filter = [this] (uint64_t key) { return frequent_extension (key); };
+
+    ExtensionTable &extensions = EXTENSIONS.enter (DFS_CODE.size ());
+
+    unsigned int slices = 1;
+    if (projected.size () >= PARALLEL_EMBEDDINGS)
+      slices = claim_threads (projected.size () / SLICE_EMBEDDINGS);
+
+    if (slices <= 1) {
+      release_threads (slices);
+      extensions.filter (filter);
+      enumerate (projected, 0, projected.size (), rmpath, extensions, HISTORY, EDGES);
+      extensions.sort ();
+      return extensions;
+    }
+
+    std::vector<unsigned int> bound (slices + 1, projected.size ());
+    bound[0] = 0;
+    for (unsigned int k = 1; k < slices; ++k) {
+      unsigned int b = std::max (bound[k-1], (unsigned int)((uint64_t)projected.size () * k / slices));
+      while (b > 0 && b < projected.size () && projected[b].id == projected[b-1].id)
+	++b;
+      bound[k] = b;
+    }
+
+    if (SLICES.size () < slices)
+      SLICES.resize (slices);
+    parallel_for (slices, slices, [&] (unsigned int k, unsigned int) {
+	EnumSlice &slice = SLICES[k];
+	slice.table.clear ();
+	slice.table.filter (filter);
+	enumerate (projected, bound[k], bound[k+1], rmpath, slice.table, slice.history, slice.edges);
+	slice.table.sort ();
+      });
+
+    std::vector<const ExtensionTable *> part (slices);
+    for (unsigned int k = 0; k < slices; ++k)
+      part[k] = &SLICES[k].table;
+    extensions.merge (part, slices);
+    release_threads (slices);
+
+    return extensions;
+  }
+
   void gSpan::project (Projected &projected)
   {
 
@@ -385,7 +569,9 @@ namespace GSPAN {
 
     /* Check if the pattern is frequent enough.
      */
-    unsigned int sup = support (projected);
+    unsigned int sup1;
+    TidSet &tids = tids_at (DFS_CODE.size ());
+    unsigned int sup = support (projected, tids, sup1);
     if (sup < minsup)
       return;
 
@@ -397,6 +583,18 @@ namespace GSPAN {
       return;
     }
 
+    /* resume (): frequent at the floor, but not yet at the threshold.
+     * Only minimal codes get here, so no duplicate keeps a copy of its
+     * embeddings.
+     */
+    if (sup < threshold) {
+      FRONTIER.push_back (FrontierEntry ());
+      FRONTIER.back ().code = DFS_CODE;
+      FRONTIER.back ().sup = sup;
+      flatten (projected, FRONTIER.back ().flat);
+      return;
+    }
+
     if (boost) {
       /* Compute the gains for all classifiers we can build out of the current
        * subgraph pattern (which is just two).
@@ -447,8 +645,9 @@ namespace GSPAN {
     } else {
 
       // Output the frequent substructure
-      report (projected, sup);
-      
+      report (projected, sup, sup1);
+      if (WY)
+	permutation_test (tids, sup);
 
     }
 
@@ -477,75 +676,28 @@ namespace GSPAN {
      * might be its (n+1)-extension-graphs, hence we enumerate them all.
      */
     const RMPath &rmpath = DFS_CODE.buildRMPath ();
-    int minlabel = DFS_CODE[0].fromlabel;
     int maxtoc = DFS_CODE[rmpath[0]].to;
 
-    Projected_map3 new_fwd_root;
-    Projected_map2 new_bck_root;
-    EdgeList edges;
-
-    /* Enumerate all possible one edge extensions of the current substructure.
+    /* Enumerate all possible one edge extensions of the current
+     * substructure, and order them, backward ones first, in DFS code
+     * order.
      */
-    for (unsigned int n = 0; n < projected.size(); ++n) {
-
-      unsigned int id = projected[n].id;
-      PDFS *cur = &projected[n];
-      History history (TRANS[id], cur);
-
-      // XXX: do we have to change something here for directed edges?
-
-      // backward
-      for (int i = (int)rmpath.size()-1; i >= 1; --i) {
-	Edge *e = get_backward (TRANS[id], history[rmpath[i]], history[rmpath[0]], history);
-	if (e)
-	  new_bck_root[DFS_CODE[rmpath[i]].from][e->elabel].push (id, e, cur);
-      }
-
-      // pure forward
-      // FIXME: here we pass a too large e->to (== history[rmpath[0]]->to
-      // into get_forward_pure, such that the assertion fails.
-      //
-      // The problem is:
-      // history[rmpath[0]]->to > TRANS[id].size()
-      if (get_forward_pure (TRANS[id], history[rmpath[0]], minlabel, history, edges))
-	for (EdgeList::iterator it = edges.begin(); it != edges.end(); ++it)
-	  new_fwd_root[maxtoc][(*it)->elabel][TRANS[id][(*it)->to].label].push (id, *it, cur);
-
-      // backtracked forward
-      for (int i = 0; i < (int)rmpath.size(); ++i)
-	if (get_forward_rmpath (TRANS[id], history[rmpath[i]], minlabel, history, edges))
-	  for (EdgeList::iterator it = edges.begin(); it != edges.end();  ++it)
-	    new_fwd_root[DFS_CODE[rmpath[i]].from][(*it)->elabel][TRANS[id][(*it)->to].label].push (id, *it, cur);
-    }
+    ExtensionTable &extensions = enumerate (projected, tids, rmpath);
 
     /* Test all extended substructures.
      */
-    // backward
-    for (Projected_iterator2 to = new_bck_root.begin(); to != new_bck_root.end(); ++to) {
-      for (Projected_iterator1 elabel = to->second.begin(); elabel != to->second.end(); ++elabel) {
-	DFS_CODE.push (maxtoc, to->first, -1, elabel->first, -1);
-	project (elabel->second);
-	DFS_CODE.pop();
-      }
+    LEVEL.set (DFS_CODE.size (), extensions.data ());
+    for (unsigned int n = 0; n < extensions.size (); ++n) {
+      if (extensions.is_forward (n))
+	DFS_CODE.push (extensions.from (n), maxtoc+1, -1, extensions.elabel (n), extensions.tolabel (n));
+      else
+	DFS_CODE.push (maxtoc, extensions.to (n), -1, extensions.elabel (n), -1);
+      Projected child = extensions[n];
+      if (! spawn (child))
+	project (child);
+      DFS_CODE.pop ();
     }
 
-    // forward
-    for (Projected_riterator3 from = new_fwd_root.rbegin() ;
-	 from != new_fwd_root.rend() ; ++from)
-      {
-	for (Projected_iterator2 elabel = from->second.begin() ;
-	     elabel != from->second.end() ; ++elabel)
-	  {
-	    for (Projected_iterator1 tolabel = elabel->second.begin();
-		 tolabel != elabel->second.end(); ++tolabel)
-	      {
-		DFS_CODE.push (from->first, maxtoc+1, -1, elabel->first, tolabel->first);
-		project (tolabel->second);
-		DFS_CODE.pop ();
-	      }
-	  }
-      }
-
     return;
   }
   
@@ -557,7 +709,9 @@ namespace GSPAN {
 
     /* Check if the pattern is frequent enough.
      */
-    unsigned int sup = support (projected);
+    unsigned int sup1;
+    TidSet &tids = tids_at (DFS_CODE.size ());
+    unsigned int sup = support (projected, tids, sup1);
     if (sup < minsup)
       return;
 
@@ -619,13 +773,14 @@ namespace GSPAN {
     } else {
 
       // Output the frequent substructure
-      report (projected, sup);
-
-      // termination condition
-      if (results_.size() * min_pv > alpha) 
-	return;
-
+      report (projected, sup, sup1);
 
+      /* Termination condition: once it holds, the whole search is
+       * abandoned, not just this branch; the extensions not explored are
+       * kept in FRONTIER for the next c_run_m ().
+       */
+      if (results_.size() * min_pv > alpha)
+	terminated = true;
     }
 
     /* In case we have a valid upper bound and our graph already exceeds it,
@@ -653,75 +808,30 @@ namespace GSPAN {
      * might be its (n+1)-extension-graphs, hence we enumerate them all.
      */
     const RMPath &rmpath = DFS_CODE.buildRMPath ();
-    int minlabel = DFS_CODE[0].fromlabel;
     int maxtoc = DFS_CODE[rmpath[0]].to;
 
-    Projected_map3 new_fwd_root;
-    Projected_map2 new_bck_root;
-    EdgeList edges;
-
-    /* Enumerate all possible one edge extensions of the current substructure.
+    /* Enumerate all possible one edge extensions of the current
+     * substructure, and order them, backward ones first, in DFS code
+     * order.
      */
-    for (unsigned int n = 0; n < projected.size(); ++n) {
-
-      unsigned int id = projected[n].id;
-      PDFS *cur = &projected[n];
-      History history (TRANS[id], cur);
-
-      // XXX: do we have to change something here for directed edges?
-
-      // backward
-      for (int i = (int)rmpath.size()-1; i >= 1; --i) {
-	Edge *e = get_backward (TRANS[id], history[rmpath[i]], history[rmpath[0]], history);
-	if (e)
-	  new_bck_root[DFS_CODE[rmpath[i]].from][e->elabel].push (id, e, cur);
-      }
-
-      // pure forward
-      // FIXME: here we pass a too large e->to (== history[rmpath[0]]->to
-      // into get_forward_pure, such that the assertion fails.
-      //
-      // The problem is:
-      // history[rmpath[0]]->to > TRANS[id].size()
-      if (get_forward_pure (TRANS[id], history[rmpath[0]], minlabel, history, edges))
-	for (EdgeList::iterator it = edges.begin(); it != edges.end(); ++it)
-	  new_fwd_root[maxtoc][(*it)->elabel][TRANS[id][(*it)->to].label].push (id, *it, cur);
-
-      // backtracked forward
-      for (int i = 0; i < (int)rmpath.size(); ++i)
-	if (get_forward_rmpath (TRANS[id], history[rmpath[i]], minlabel, history, edges))
-	  for (EdgeList::iterator it = edges.begin(); it != edges.end();  ++it)
-	    new_fwd_root[DFS_CODE[rmpath[i]].from][(*it)->elabel][TRANS[id][(*it)->to].label].push (id, *it, cur);
-    }
+    ExtensionTable &extensions = enumerate (projected, tids, rmpath);
 
     /* Test all extended substructures.
      */
-    // backward
-    for (Projected_iterator2 to = new_bck_root.begin(); to != new_bck_root.end(); ++to) {
-      for (Projected_iterator1 elabel = to->second.begin(); elabel != to->second.end(); ++elabel) {
-	DFS_CODE.push (maxtoc, to->first, -1, elabel->first, -1);
-	project (elabel->second, min_pv, alpha);
-	DFS_CODE.pop();
-      }
+    LEVEL.set (DFS_CODE.size (), extensions.data ());
+    for (unsigned int n = 0; n < extensions.size (); ++n) {
+      if (extensions.is_forward (n))
+	DFS_CODE.push (extensions.from (n), maxtoc+1, -1, extensions.elabel (n), extensions.tolabel (n));
+      else
+	DFS_CODE.push (maxtoc, extensions.to (n), -1, extensions.elabel (n), -1);
+      Projected child = extensions[n];
+      if (terminated)
+	postpone (child);
+      else
+	project (child, min_pv, alpha);
+      DFS_CODE.pop ();
     }
 
-    // forward
-    for (Projected_riterator3 from = new_fwd_root.rbegin() ;
-	 from != new_fwd_root.rend() ; ++from)
-      {
-	for (Projected_iterator2 elabel = from->second.begin() ;
-	     elabel != from->second.end() ; ++elabel)
-	  {
-	    for (Projected_iterator1 tolabel = elabel->second.begin();
-		 tolabel != elabel->second.end(); ++tolabel)
-	      {
-		DFS_CODE.push (from->first, maxtoc+1, -1, elabel->first, tolabel->first);
-		project (tolabel->second, min_pv, alpha);
-		DFS_CODE.pop ();
-	      }
-	  }
-      }
-
     return;
   }
 
@@ -741,6 +851,13 @@ namespace GSPAN {
     boostWeights = _boostWeights;
     boostType = _boostType;
 
+    /* The caller indexes samples in input order.
+     */
+    for (unsigned int n = 0 ; n < inputOrder.size() ; ++n) {
+      boostY[n] = _boostY[inputOrder[n]];
+      boostWeights[n] = _boostWeights[inputOrder[n]];
+    }
+
     /* Setup the corresponding function pointers for the gain function adn the
      * gainbound function.
      */
@@ -761,24 +878,160 @@ namespace GSPAN {
     bestGraphs.clear ();
   }
 
+  /* Start a new run: forget the results of the previous one, and
+   * preprocess the database unless that was already done for min_sup.
+   */
+  void gSpan::reset (unsigned int min_sup)
+  {
+    results_.clear ();
+    class_results_.clear ();
+    singleVertex.clear ();
+    singleVertexLabel.clear ();
+    ID = 0;
+    terminated = false;
+    threshold = 0;
+    resuming = false;
+    early = false;
+    FRONTIER.clear ();
+
+    if (! prepared || min_sup != minsup) {
+      minsup = min_sup;
+      preprocess ();
+      prepared = true;
+    }
+  }
+
+  /* The supports are handed over, not copied; class_support () keeps
+   * the class supports until the next run.
+   */
   std::vector<unsigned> gSpan::run(const unsigned min_sup)
   {
-    minsup = min_sup;
-    // init
+    reset (min_sup);
     run_intern();
-    return results_;
+    return std::move (results_);
   }
   
   std::size_t
   gSpan::c_run_m(const unsigned min_sup, double min_pv, double alpha)
   {
-    minsup = min_sup;
-    // init
+    if (early && min_sup >= threshold)
+      return resume_early (min_sup, min_pv, alpha);
+
+    reset (min_sup);
+    early = true;
+    threshold = min_sup;
     run_intern(min_pv, alpha);
 
     return results_.size();
   }
 
+  std::vector<std::size_t> gSpan::support_histogram (const unsigned min_sup)
+  {
+    reset (min_sup);
+    histogram_.assign (min_sup + 1, 0);
+    counting = true;
+    run_intern();
+    counting = false;
+
+    std::vector<std::size_t> m (histogram_.size () + 1, 0);
+    for (unsigned int f = histogram_.size (); f-- > 0; )
+      m[f] = m[f+1] + histogram_[f];
+    for (unsigned int f = 0; f < min_sup; ++f)
+      m[f] = m[min_sup];
+
+    return m;
+  }
+
+
+  void gSpan::raise_support ()
+  {
+    while (lampcount > 0 && lampcount * LAMP->min_p (minsup) > lampalpha) {
+      if (minsup < histogram_.size ())
+	lampcount -= histogram_[minsup];
+      ++minsup;
+    }
+  }
+
+  unsigned int gSpan::lamp (const double alpha)
+  {
+    if (n1_ == 0) {
+      std::cerr << "lamp () needs the classes of the graphs" << std::endl;
+      exit (-1);
+    }
+
+    /* Below the minimum admissible support even a single pattern is too
+     * many.
+     */
+    thesis::Fisher fisher (n1_, n2_);
+    unsigned int lowest = 1;
+    while (lowest < n1_ && fisher.min_p (lowest) > alpha)
+      ++lowest;
+
+    reset (lowest);
+    histogram_.assign (lowest + 1, 0);
+    counting = true;
+    LAMP = &fisher;
+    lampalpha = alpha;
+    lampcount = 0;
+    run_intern ();
+    LAMP = 0;
+    counting = false;
+
+    /* The counts of the supports >= minsup are exact; find the largest
+     * one still failing, as lamp_dec_ does.
+     */
+    unsigned int sigma = minsup;
+    minsup = lowest;	// what TRANS was built for
+
+    std::size_t m = 0;
+    for (unsigned int f = histogram_.size (); f-- > sigma; ) {
+      m += histogram_[f];
+      if (m * fisher.min_p (f) > alpha)
+	return f + 1;
+    }
+    return sigma;
+  }
+
+  /* The edges of TRANS grouped by (fromlabel, elabel, tolabel) and
+   * sorted: the roots of the search.
+   */
+  ExtensionTable &gSpan::root_table ()
+  {
+    EdgeList &edges = EDGES;
+    ExtensionTable &root = EXTENSIONS.enter (0);
+
+    for (unsigned int id = 0; id < TRANS.size(); ++id) {
+      GraphRef g = TRANS[id];
+      for (unsigned int from = 0; from < g.size() ; ++from) {
+	if (get_forward_root (g, from, edges)) {
+	  for (EdgeList::iterator it = edges.begin(); it != edges.end();  ++it)
+	    root.push (ExtensionTable::root (g.label (from), (*it)->elabel, g.label ((*it)->to)), id, g.index (*it), 0);
+	}
+      }
+    }
+
+    root.sort ();
+    LEVEL.set (0, root.data ());
+    return root;
+  }
+
+  /* Vertex label counts of every graph (singleVertex) and number of
+   * graphs of every vertex label (singleVertexLabel).
+   */
+  void gSpan::count_single_vertices ()
+  {
+    for (unsigned int id = 0; id < TRANS.size(); ++id) {
+      GraphRef g = INPUT[id];
+      for (unsigned int nid = 0 ; nid < g.size() ; ++nid) {
+	if (singleVertex[id][g.label (nid)] == 0) {
+	  // number of graphs it appears in
+	  singleVertexLabel[g.label (nid)] += 1;
+	}
+
+	singleVertex[id][g.label (nid)] += 1;
+      }
+    }
+  }
 
   void gSpan::run_intern (void)
   {
@@ -791,16 +1044,7 @@ namespace GSPAN {
        * cannot find subgraphs of size |subg|==1.  Hence, we find frequent node
        * labels explicitly.
        */
-      for (unsigned int id = 0; id < TRANS.size(); ++id) {
-	for (unsigned int nid = 0 ; nid < TRANS[id].size() ; ++nid) {
-	  if (singleVertex[id][TRANS[id][nid].label] == 0) {
-	    // number of graphs it appears in
-	    singleVertexLabel[TRANS[id][nid].label] += 1;
-	  }
-
-	  singleVertex[id][TRANS[id][nid].label] += 1;
-	}
-      }
+      count_single_vertices ();
       /* All minimum support node labels are frequent 'subgraphs'.
        * singleVertexLabel[nodelabel] gives the number of graphs it appears
        * in.
@@ -877,51 +1121,51 @@ namespace GSPAN {
 	       */
 	      std::map<unsigned int, unsigned int> gycounts;
 	      for (unsigned int n = 0 ; n < counts.size () ; ++n)
-		gycounts[n] = counts[n];
+		gycounts[input_id (n)] = counts[n];
 
 	      report_boosting_inter (g, (*it).second, gainm, yval, gycounts);
 	    }
 	  } else {
 	    std::map<unsigned int, unsigned int> gycounts;
 	    for (unsigned int n = 0 ; n < counts.size () ; ++n)
-	      gycounts[n] = counts[n];
+	      gycounts[input_id (n)] = counts[n];
 
 	    report_single (g, gycounts);
+
+	    if (WY) {
+	      TidSet tids;
+	      tids.reset (TRANS.size ());
+	      for (unsigned int n = 0 ; n < counts.size () ; ++n)
+		if (counts[n] > 0)
+		  tids.set (n);
+	      permutation_test (tids, (*it).second);
+	    }
 	  }
 	}
     }
 
-    EdgeList edges;
-    Projected_map3 root;
-
-    for (unsigned int id = 0; id < TRANS.size(); ++id) {
-      Graph &g = TRANS[id];
-      for (unsigned int from = 0; from < g.size() ; ++from) {
-	if (get_forward_root (g, g[from], edges)) {
-	  for (EdgeList::iterator it = edges.begin(); it != edges.end();  ++it)
-	    root[g[from].label][(*it)->elabel][g[(*it)->to].label].push (id, *it, 0);
-	}
-      }
+    /* lamp () and westfall_young () raise minsup as they go, which only
+     * the sequential search sees.
+     */
+    ExtensionTable &root = root_table ();
+    if (! WORKER_HOSTS.empty () && ! boost && ! LAMP && ! WY && root.size () > 0) {
+      project_remote (root);
+      return;
+    }
+    if (threads > 1 && ! boost && ! LAMP && ! WY && root.size () > 1) {
+      project_roots (root);
+      return;
     }
 
-    for (Projected_iterator3 fromlabel = root.begin() ;
-	 fromlabel != root.end() ; ++fromlabel)
-      {
-	for (Projected_iterator2 elabel = fromlabel->second.begin() ;
-	     elabel != fromlabel->second.end() ; ++elabel)
-	  {
-	    for (Projected_iterator1 tolabel = elabel->second.begin();
-		 tolabel != elabel->second.end(); ++tolabel)
-	      {
-		/* Build the initial two-node graph.  It will be grown
-		 * recursively within project.
-		 */
-		DFS_CODE.push (0, 1, fromlabel->first, elabel->first, tolabel->first);
-		project (tolabel->second);
-		DFS_CODE.pop ();
-	      }
-	  }
-      }
+    for (unsigned int n = 0; n < root.size (); ++n) {
+      /* Build the initial two-node graph.  It will be grown
+       * recursively within project.
+       */
+      DFS_CODE.push (0, 1, root.fromlabel (n), root.elabel (n), root.tolabel (n));
+      Projected projected = root[n];
+      project (projected);
+      DFS_CODE.pop ();
+    }
   }
 
   void gSpan::run_intern (double min_pv, double alpha)
@@ -935,16 +1179,7 @@ namespace GSPAN {
        * cannot find subgraphs of size |subg|==1.  Hence, we find frequent node
        * labels explicitly.
        */
-      for (unsigned int id = 0; id < TRANS.size(); ++id) {
-	for (unsigned int nid = 0 ; nid < TRANS[id].size() ; ++nid) {
-	  if (singleVertex[id][TRANS[id][nid].label] == 0) {
-	    // number of graphs it appears in
-	    singleVertexLabel[TRANS[id][nid].label] += 1;
-	  }
-
-	  singleVertex[id][TRANS[id][nid].label] += 1;
-	}
-      }
+      count_single_vertices ();
       /* All minimum support node labels are frequent 'subgraphs'.
        * singleVertexLabel[nodelabel] gives the number of graphs it appears
        * in.
@@ -1021,14 +1256,14 @@ namespace GSPAN {
 	       */
 	      std::map<unsigned int, unsigned int> gycounts;
 	      for (unsigned int n = 0 ; n < counts.size () ; ++n)
-		gycounts[n] = counts[n];
+		gycounts[input_id (n)] = counts[n];
 
 	      report_boosting_inter (g, (*it).second, gainm, yval, gycounts);
 	    }
 	  } else {
 	    std::map<unsigned int, unsigned int> gycounts;
 	    for (unsigned int n = 0 ; n < counts.size () ; ++n)
-	      gycounts[n] = counts[n];
+	      gycounts[input_id (n)] = counts[n];
 
 	    report_single (g, gycounts);
 
@@ -1038,37 +1273,19 @@ namespace GSPAN {
 	}
     }
 
-    EdgeList edges;
-    Projected_map3 root;
-
-    for (unsigned int id = 0; id < TRANS.size(); ++id) {
-      Graph &g = TRANS[id];
-      for (unsigned int from = 0; from < g.size() ; ++from) {
-	if (get_forward_root (g, g[from], edges)) {
-	  for (EdgeList::iterator it = edges.begin(); it != edges.end();  ++it)
-	    root[g[from].label][(*it)->elabel][g[(*it)->to].label].push (id, *it, 0);
-	}
-      }
+    ExtensionTable &root = root_table ();
+    for (unsigned int n = 0; n < root.size (); ++n) {
+      /* Build the initial two-node graph.  It will be grown
+       * recursively within project.
+       */
+      DFS_CODE.push (0, 1, root.fromlabel (n), root.elabel (n), root.tolabel (n));
+      Projected projected = root[n];
+      if (terminated)
+	postpone (projected);
+      else
+	project (projected, min_pv, alpha);
+      DFS_CODE.pop ();
     }
-
-    for (Projected_iterator3 fromlabel = root.begin() ;
-	 fromlabel != root.end() ; ++fromlabel)
-      {
-	for (Projected_iterator2 elabel = fromlabel->second.begin() ;
-	     elabel != fromlabel->second.end() ; ++elabel)
-	  {
-	    for (Projected_iterator1 tolabel = elabel->second.begin();
-		 tolabel != elabel->second.end(); ++tolabel)
-	      {
-		/* Build the initial two-node graph.  It will be grown
-		 * recursively within project.
-		 */
-		DFS_CODE.push (0, 1, fromlabel->first, elabel->first, tolabel->first);
-		project (tolabel->second, min_pv, alpha);
-		DFS_CODE.pop ();
-	      }
-	  }
-      }
   }
 
 }
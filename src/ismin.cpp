@@ -23,6 +23,33 @@
 
 namespace GSPAN {
 
+/* Order of two (elabel, tolabel) or (fromlabel, elabel, tolabel) tuples:
+   negative, zero or positive.
+ */
+static inline int compare (int a1, int b1, int c1, int a2, int b2, int c2)
+{
+	if (a1 != a2) return a1 < a2 ? -1 : 1;
+	if (b1 != b2) return b1 < b2 ? -1 : 1;
+	if (c1 != c2) return c1 < c2 ? -1 : 1;
+	return 0;
+}
+
+/* Embedding buffer of depth k of the canonical check, kept across calls.
+ */
+std::vector<PDFS> &gSpan::projected_is_min (unsigned int k)
+{
+	if (PROJECTED_IS_MIN.size () <= k)
+		PROJECTED_IS_MIN.resize (k + 1);
+	PROJECTED_IS_MIN[k].clear ();
+	return PROJECTED_IS_MIN[k];
+}
+
+/* DFS_CODE is minimal iff growing the minimum DFS code of its graph one
+   least extension at a time reproduces it.  Rather than collecting every
+   extension and taking the least, each step only keeps the embeddings of
+   the extension equal to the next element of DFS_CODE, and gives up as
+   soon as any smaller extension shows up.
+ */
 bool gSpan::is_min ()
 {
 	if (DFS_CODE.size() == 1)
@@ -31,94 +58,117 @@ bool gSpan::is_min ()
 	DFS_CODE.toGraph (GRAPH_IS_MIN);
 	DFS_CODE_IS_MIN.clear ();
 
-	Projected_map3 root;
-	EdgeList           edges;
-
-	for (unsigned int from = 0; from < GRAPH_IS_MIN.size() ; ++from)
-		if (get_forward_root (GRAPH_IS_MIN, GRAPH_IS_MIN[from], edges))
-			for (EdgeList::iterator it = edges.begin(); it != edges.end();  ++it)
-				root[GRAPH_IS_MIN[from].label][(*it)->elabel][GRAPH_IS_MIN[(*it)->to].label].push (0, *it, 0);
-
-	Projected_iterator3 fromlabel = root.begin();
-	Projected_iterator2 elabel    = fromlabel->second.begin();
-	Projected_iterator1 tolabel   = elabel->second.begin();
+	GraphRef g               = GRAPH_IS_MIN[0];
+	const DFS &first         = DFS_CODE[0];
+	std::vector<PDFS> &root  = projected_is_min (0);
+	EdgeList &edges          = EDGES;
+
+	for (unsigned int from = 0; from < g.size() ; ++from) {
+		if (g.label (from) > first.fromlabel || ! get_forward_root (g, from, edges))
+			continue;
+
+		for (EdgeList::iterator it = edges.begin(); it != edges.end();  ++it) {
+			int c = compare (g.label (from), (*it)->elabel, g.label ((*it)->to),
+					 first.fromlabel, first.elabel, first.tolabel);
+			if (c < 0)
+				return false;
+			if (c == 0) {
+				PDFS d;
+				d.edge = g.index (*it);
+				root.push_back (d);
+			}
+		}
+	}
 
-	DFS_CODE_IS_MIN.push (0, 1, fromlabel->first, elabel->first, tolabel->first);
+	DFS_CODE_IS_MIN.push (0, 1, first.fromlabel, first.elabel, first.tolabel);
+	LEVEL_IS_MIN.set (0, root.data ());
 
-	return (project_is_min (tolabel->second));
+	Projected projected (root.data (), root.data () + root.size ());
+	return (project_is_min (projected));
 }
 
 bool gSpan::project_is_min (Projected &projected)
 {
+	unsigned int k = DFS_CODE_IS_MIN.size ();
+	if (k == DFS_CODE.size ())
+		return true;
+
+	const DFS &next      = DFS_CODE[k];
+	bool backward        = next.from > next.to;
 	const RMPath& rmpath = DFS_CODE_IS_MIN.buildRMPath ();
 	int minlabel         = DFS_CODE_IS_MIN[0].fromlabel;
 	int maxtoc           = DFS_CODE_IS_MIN[rmpath[0]].to;
-
-	{
-		Projected_map1 root;
-		bool flg = false;
-		int newto = 0;
-
-		for (int i = rmpath.size()-1; ! flg  && i >= 1; --i) {
-			for (unsigned int n = 0; n < projected.size(); ++n) {
-				PDFS *cur = &projected[n];
-				History history (GRAPH_IS_MIN, cur);
-				Edge *e = get_backward (GRAPH_IS_MIN, history[rmpath[i]], history[rmpath[0]], history);
-				if (e) {
-					root[e->elabel].push (0, e, cur);
-					newto = DFS_CODE_IS_MIN[rmpath[i]].from;
-					flg = true;
-				}
-			}
-		}
-
-		if (flg) {
-			Projected_iterator1 elabel = root.begin();
-			DFS_CODE_IS_MIN.push (maxtoc, newto, -1, elabel->first, -1);
-			if (DFS_CODE[DFS_CODE_IS_MIN.size()-1] != DFS_CODE_IS_MIN [DFS_CODE_IS_MIN.size()-1]) return false;
-			return project_is_min (elabel->second);
-		}
-	}
-
-	{
-		bool flg = false;
-		int newfrom = 0;
-		Projected_map2 root;
-		EdgeList edges;
-
-		for (unsigned int n = 0; n < projected.size(); ++n) {
-			PDFS *cur = &projected[n];
-			History history (GRAPH_IS_MIN, cur);
-			if (get_forward_pure (GRAPH_IS_MIN, history[rmpath[0]], minlabel, history, edges)) {
-				flg = true;
-				newfrom = maxtoc;
-				for (EdgeList::iterator it = edges.begin(); it != edges.end();  ++it)
-					root[(*it)->elabel][GRAPH_IS_MIN[(*it)->to].label].push (0, *it, cur);
+	GraphRef g           = GRAPH_IS_MIN[0];
+	History &history     = HISTORY;
+	EdgeList &edges      = EDGES;
+	std::vector<PDFS> &child = projected_is_min (k);
+
+	history.restart ();
+	for (unsigned int n = 0; n < projected.size(); ++n) {
+		unsigned int cur = projected.index (n);
+		history.build (g, LEVEL_IS_MIN, k, cur);
+
+		/* Backward extensions, by increasing to; all of them precede the
+		 * forward ones.
+		 */
+		for (int i = rmpath.size()-1; i >= 1; --i) {
+			int to = DFS_CODE_IS_MIN[rmpath[i]].from;
+			if (backward && to > next.to)
+				break;
+
+			const Edge *e = get_backward (g, history[rmpath[i]], history[rmpath[0]], history);
+			if (! e)
+				continue;
+			if (! backward || to < next.to || e->elabel < next.elabel)
+				return false;
+			if (e->elabel == next.elabel) {
+				PDFS d;
+				d.edge = g.index (e); d.prev = cur;
+				child.push_back (d);
 			}
 		}
 
-		for (int i = 0; ! flg && i < (int)rmpath.size(); ++i) {
-			for (unsigned int n = 0; n < projected.size(); ++n) {
-				PDFS *cur = &projected[n];
-				History history (GRAPH_IS_MIN, cur);
-				if (get_forward_rmpath (GRAPH_IS_MIN, history[rmpath[i]], minlabel, history, edges)) {
-					flg = true;
-					newfrom = DFS_CODE_IS_MIN[rmpath[i]].from;
-					for (EdgeList::iterator it = edges.begin(); it != edges.end();  ++it)
-						root[(*it)->elabel][GRAPH_IS_MIN[(*it)->to].label].push (0, *it, cur);
+		if (backward)
+			continue;
+
+		/* Forward extensions, by decreasing from: the pure ones, from
+		 * maxtoc, then those from the rightmost path.
+		 */
+		for (int i = -1; i < (int)rmpath.size(); ++i) {
+			int from = i < 0 ? maxtoc : DFS_CODE_IS_MIN[rmpath[i]].from;
+			if (from < next.from)
+				break;
+
+			if (! (i < 0 ? get_forward_pure (g, history[rmpath[0]], minlabel, history, edges)
+			       : get_forward_rmpath (g, history[rmpath[i]], minlabel, history, edges)))
+				continue;
+			if (from > next.from)
+				return false;
+
+			for (EdgeList::iterator it = edges.begin(); it != edges.end();  ++it) {
+				int c = compare (0, (*it)->elabel, g.label ((*it)->to), 0, next.elabel, next.tolabel);
+				if (c < 0)
+					return false;
+				if (c == 0) {
+					PDFS d;
+					d.edge = g.index (*it); d.prev = cur;
+					child.push_back (d);
 				}
 			}
 		}
-
-		if (flg) {
-			Projected_iterator2 elabel  = root.begin();
-			Projected_iterator1 tolabel = elabel->second.begin();
-			DFS_CODE_IS_MIN.push (newfrom, maxtoc + 1, -1, elabel->first, tolabel->first);
-			if (DFS_CODE[DFS_CODE_IS_MIN.size()-1] != DFS_CODE_IS_MIN [DFS_CODE_IS_MIN.size()-1]) return false;
-			return project_is_min (tolabel->second);
-		}
 	}
 
-	return true;
+	/* DFS_CODE is a code of this graph, so an empty child means a smaller
+	 * extension came first.
+	 */
+	if (child.empty ())
+		return false;
+
+	DFS_CODE_IS_MIN.push_back (next);
+	LEVEL_IS_MIN.set (k, child.data ());
+
+	Projected p (child.data (), child.data () + child.size ());
+	return project_is_min (p);
 }
+
 }
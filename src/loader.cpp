@@ -0,0 +1,377 @@
+/*
+   Zero-copy loader for the t/v/e transaction format.
+
+   The input file is mapped into memory and parsed in place: lines are
+   split into tokens by pointer arithmetic and integers are converted
+   without building intermediate strings, so loading is bound by I/O
+   rather than by iostream overhead.  Large inputs are split at "t" lines
+   and parsed on several threads.  Files in the binary database
+   format (see binary.cpp) and gzip compressed transaction files are
+   recognised by their magic number.
+*/
+#include "gspan.h"
+#include "parallel.h"
+#include <iterator>
+#include <fstream>
+#include <cctype>
+
+#include <zlib.h>
+
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace GSPAN {
+
+/* Smallest piece of input worth handing to a loader thread.
+ */
+static const std::size_t LOAD_CHUNK = 1 << 18;
+
+/* Initial size of the decompression buffer for gzip input.
+ */
+static const std::size_t GZIP_BUFFER = 1 << 20;
+
+bool MappedFile::open (const char *filename)
+{
+	close ();
+
+	int fd = ::open (filename, O_RDONLY);
+	if (fd < 0)
+		return false;
+
+	struct stat st;
+	if (fstat (fd, &st) < 0) {
+		::close (fd);
+		return false;
+	}
+
+	size_ = st.st_size;
+	if (size_ > 0) {
+		void *p = mmap (0, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (p == MAP_FAILED) {
+			::close (fd);
+			size_ = 0;
+			return false;
+		}
+		madvise (p, size_, MADV_SEQUENTIAL);
+		data_ = (const char *)p;
+	}
+
+	::close (fd);
+	return true;
+}
+
+void MappedFile::close ()
+{
+	if (data_)
+		munmap ((void *)data_, size_);
+	data_ = 0;
+	size_ = 0;
+}
+
+/* Split the line [p, end) into at most four whitespace separated tokens.
+   tok[0] keeps the first token's position and length, tok[1..3] its numeric
+   values (atoi semantics).  Returns the total number of tokens.
+ */
+static inline unsigned int
+split_line (const char *p, const char *end, const char *&key, unsigned int &keylen, int *val)
+{
+	unsigned int n = 0;
+
+	while (true) {
+		while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\v' || *p == '\f'))
+			++p;
+		if (p == end)
+			break;
+
+		const char *b = p;
+		while (p < end && ! (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\v' || *p == '\f'))
+			++p;
+
+		if (n == 0) {
+			key = b;
+			keylen = p - b;
+		} else if (n <= 3) {
+			bool neg = false;
+			if (b < p && (*b == '-' || *b == '+'))
+				neg = (*b++ == '-');
+			int v = 0;
+			for (; b < p && *b >= '0' && *b <= '9'; ++b)
+				v = v * 10 + (*b - '0');
+			val[n] = neg ? -v : v;
+		}
+		++n;
+	}
+
+	return n;
+}
+
+/* Parse the transactions in [p, end) and append them to db.
+ */
+static void parse (const char *p, const char *end, GraphDB &db)
+{
+	int val[4];
+	const char *key = 0;
+	unsigned int keylen = 0;
+
+	while (p < end) {
+		const char *eol = (const char *)memchr (p, '\n', end - p);
+		if (! eol)
+			eol = end;
+
+		unsigned int n = split_line (p, eol, key, keylen, val);
+		p = eol + 1;
+
+		if (n == 0 || keylen != 1)
+			continue;
+
+		if (*key == 't') {
+			if (! db.new_label.empty ()) // use as delimiter
+				db.end_graph ();
+		} else if (*key == 'v' && n >= 3) {
+			db.new_label.resize (val[1] + 1);
+			db.new_label[val[1]] = val[2];
+		} else if (*key == 'e' && n >= 4) {
+			int from   = val[1];
+			int to     = val[2];
+			int elabel = val[3];
+
+			if ((int)db.new_label.size () <= from || (int)db.new_label.size () <= to) {
+				std::cerr << "Format Error:  define vertex lists before edges" << std::endl;
+				exit (-1);
+			}
+
+			db.push_edge (from, to, elabel);
+		}
+	}
+
+	if (! db.new_label.empty ())
+		db.end_graph ();
+}
+
+/* True if the line starting at p has "t" as its first token.
+ */
+static inline bool is_transaction (const char *p, const char *end)
+{
+	while (p < end && (*p == ' ' || *p == '\t'))
+		++p;
+	return p < end && *p == 't' && (p + 1 == end || isspace ((unsigned char)p[1]));
+}
+
+/* Start of the first line at or after p whose first token is "t", or end.
+ */
+static const char *next_transaction (const char *p, const char *begin, const char *end)
+{
+	if (p > begin) {
+		p = (const char *)memchr (p - 1, '\n', end - (p - 1));
+		p = p ? p + 1 : end;
+	}
+
+	while (p < end && ! is_transaction (p, end)) {
+		p = (const char *)memchr (p, '\n', end - p);
+		p = p ? p + 1 : end;
+	}
+
+	return p;
+}
+
+/* Split the input at transaction boundaries and parse the pieces on the
+   loader threads, each into its own arena; the arenas are appended in
+   file order, so graph ids are those of a sequential read.
+ */
+void gSpan::read (const char *begin, const char *end)
+{
+	INPUT.directed = directed;
+
+	std::size_t chunks = std::min<std::size_t> (threads * 4, (end - begin) / LOAD_CHUNK + 1);
+	if (threads <= 1 || chunks <= 1) {
+		parse (begin, end, INPUT);
+		return;
+	}
+
+	std::vector<const char *> bound (chunks + 1);
+	bound[0] = begin;
+	bound[chunks] = end;
+	for (std::size_t k = 1; k < chunks; ++k)
+		bound[k] = next_transaction (std::max (bound[k-1], begin + (end - begin) / chunks * k),
+					     begin, end);
+
+	std::vector<GraphDB> part (chunks, GraphDB (directed));
+	parallel_for (chunks, threads, [&] (unsigned int k, unsigned int) {
+			parse (bound[k], bound[k+1], part[k]);
+		});
+
+	for (std::size_t k = 0; k < chunks; ++k)
+		INPUT.append (part[k]);
+}
+
+/* Start of the last line in [begin, end) whose first token is "t", or
+   begin if there is none.
+ */
+static const char *last_transaction (const char *begin, const char *end)
+{
+	for (const char *p = end; p > begin; --p)
+		if ((p - 1 == begin || p[-2] == '\n') && is_transaction (p - 1, end))
+			return p - 1;
+
+	return begin;
+}
+
+/* True if [data, data + size) starts with the gzip magic number.
+ */
+static inline bool is_gzip (const char *data, std::size_t size)
+{
+	return size >= 2 && (unsigned char)data[0] == 0x1f && (unsigned char)data[1] == 0x8b;
+}
+
+/* Inflate gzip (or zlib) data and parse it as it comes.  Only complete
+   transactions are parsed; the incomplete tail is kept for the next round,
+   so the decompressed text never has to exist as a whole.  Concatenated
+   gzip members are read one after another; whatever follows the last
+   member that is not another one (such as zero padding) is ignored, as
+   gzip does.
+ */
+void gSpan::read_gzip (const char *data, std::size_t size)
+{
+	z_stream zs;
+	std::memset (&zs, 0, sizeof (zs));
+	if (inflateInit2 (&zs, 15 + 32) != Z_OK) {
+		std::cerr << "Cannot initialize zlib" << std::endl;
+		exit (-1);
+	}
+
+	INPUT.directed = directed;
+
+	zs.next_in = (Bytef *)data;
+	std::size_t left = size;
+	std::vector<char> buf (GZIP_BUFFER);
+	std::size_t len = 0;
+
+	while (true) {
+		if (zs.avail_in == 0) {
+			zs.avail_in = std::min<std::size_t> (left, 1u << 30);
+			left -= zs.avail_in;
+		}
+		if (len == buf.size ())
+			buf.resize (2 * buf.size ());
+
+		zs.next_out  = (Bytef *)buf.data () + len;
+		zs.avail_out = buf.size () - len;
+
+		int ret = inflate (&zs, Z_NO_FLUSH);
+		if (ret != Z_OK && ret != Z_STREAM_END) {
+			std::cerr << "Format Error:  corrupt or truncated gzip input" << std::endl;
+			exit (-1);
+		}
+		len = buf.size () - zs.avail_out;
+
+		bool done = (ret == Z_STREAM_END &&
+			     ! is_gzip ((const char *)zs.next_in, zs.avail_in + left));
+		const char *cut = done ? buf.data () + len : last_transaction (buf.data (), buf.data () + len);
+		parse (buf.data (), cut, INPUT);
+		len -= cut - buf.data ();
+		std::memmove (buf.data (), cut, len);
+
+		if (done)
+			break;
+		if (ret == Z_STREAM_END)
+			inflateReset (&zs);
+	}
+
+	inflateEnd (&zs);
+}
+
+void gSpan::read (const char *filename)
+{
+	std::shared_ptr<MappedFile> file (new MappedFile);
+
+	if (! file->open (filename)) {
+		std::cerr << "Cannot open " << filename << std::endl;
+		exit (-1);
+	}
+
+	if (INPUT.map (file))
+		directed = INPUT.directed;
+	else
+		read_text (file->data (), file->size ());
+}
+
+/* Transactions as text or gzip compressed text.
+ */
+void gSpan::read_text (const char *data, std::size_t size)
+{
+	if (is_gzip (data, size))
+		read_gzip (data, size);
+	else
+		read (data, data + size);
+}
+
+/* The class file holds one integer label per line, in the order of the
+   graphs.  More than two labels are folded into "least frequent label"
+   against the rest.  The graphs of that class are moved to the front
+   (stably), so the class of a graph is a comparison of its id with n1.
+ */
+void gSpan::read_classes (const char *filename)
+{
+	std::ifstream is (filename);
+	if (! is) {
+		std::cerr << "Cannot open " << filename << std::endl;
+		exit (-1);
+	}
+
+	std::vector<int> label;
+	for (int c; is >> c; )
+		label.push_back (c);
+
+	if (label.size () != INPUT.size ()) {
+		std::cerr << "Format Error:  " << filename << " has " << label.size ()
+			  << " labels for " << INPUT.size () << " graphs" << std::endl;
+		exit (-1);
+	}
+
+	/* The labels are in file order, INPUT may already be reordered by an
+	 * earlier class file: cls[id] = class of graph id.
+	 */
+	std::vector<int> cls (label.size ());
+	for (unsigned int id = 0; id < cls.size (); ++id)
+		cls[id] = label[input_id (id)];
+
+	std::map<int, unsigned int> count;
+	for (unsigned int id = 0; id < cls.size (); ++id)
+		++count[cls[id]];
+
+	int minority = 0;
+	n1_ = 0xffffffff;
+	for (std::map<int, unsigned int>::iterator it = count.begin (); it != count.end (); ++it)
+		if (it->second < n1_) {
+			minority = it->first;
+			n1_ = it->second;
+		}
+	if (count.size () < 2) {
+		std::cerr << "Format Error:  " << filename << " has a single class" << std::endl;
+		exit (-1);
+	}
+	n2_ = cls.size () - n1_;
+
+	std::vector<unsigned int> perm;	// [new id] = current id
+	for (unsigned int id = 0; id < cls.size (); ++id)
+		if (cls[id] == minority)
+			perm.push_back (id);
+	for (unsigned int id = 0; id < cls.size (); ++id)
+		if (cls[id] != minority)
+			perm.push_back (id);
+
+	GraphDB sorted (INPUT.directed);
+	std::vector<unsigned int> order (perm.size ());
+	for (unsigned int id = 0; id < perm.size (); ++id) {
+		sorted.push (INPUT[perm[id]]);
+		order[id] = input_id (perm[id]);
+	}
+	INPUT = std::move (sorted);
+	inputOrder.swap (order);
+	prepared = false;
+}
+
+}
@@ -42,25 +42,73 @@ const RMPath &DFSCode::buildRMPath ()
 	return rmpath;
 }
 
-void History::build (Graph &graph, PDFS *e)
+void History::mark (unsigned int pos)
 {
-	// first build history
-	clear ();
-	edge.clear ();
-	edge.resize (graph.edge_size());
-	vertex.clear ();
-	vertex.resize (graph.size());
-
-	if (e) {
-		push_back (e->edge);
-		edge[e->edge->id] = vertex[e->edge->from] = vertex[e->edge->to] = 1;
-
-		for (PDFS *p = e->prev ; p ; p = p->prev) {
-			push_back (p->edge);	// this line eats 8% of overall instructions(!)
-			edge[p->edge->id] = vertex[p->edge->from] = vertex[p->edge->to] = 1;
+	const Edge *e = (*this)[pos];
+	if (edge[e->id] < base)
+		edge[e->id] = base + pos;
+	if (vertex[e->from] < base)
+		vertex[e->from] = base + pos;
+	if (vertex[e->to] < base)
+		vertex[e->to] = base + pos;
+}
+
+void History::unmark (unsigned int pos)
+{
+	const Edge *e = (*this)[pos];
+	if (edge[e->id] == base + pos)
+		edge[e->id] = 0;
+	if (vertex[e->from] == base + pos)
+		vertex[e->from] = 0;
+	if (vertex[e->to] == base + pos)
+		vertex[e->to] = 0;
+}
+
+void History::build (const GraphRef &graph, const EmbeddingLevels &level, unsigned int len, unsigned int index)
+{
+	/* The embeddings of one Projected have the same length, so look for
+	 * the last build's embedding at the same position: from there on the
+	 * chains are the same.
+	 */
+	unsigned int keep = 0;
+	if (len == size ()) {
+		int pos = (int)len - 1;
+		for (unsigned int i = index; pos >= 0 && i != pdfs[pos]; --pos)
+			i = level[pos][i].prev;
+		keep = pos + 1;
+	}
+
+	if (keep) {
+		if (! sparse)
+			for (unsigned int i = keep; i < len; ++i)
+				unmark (i);
+	} else {
+		sparse = graph.edge_size () > SPARSE;
+		if (! sparse) {
+			if (top > 0xffffffffu - len - 1) {
+				std::fill (edge.begin (), edge.end (), 0);
+				std::fill (vertex.begin (), vertex.end (), 0);
+				top = 0;
+			}
+			base = top + 1;
+			top = base + len;
+			if (edge.size () < graph.edge_size ())
+				edge.resize (graph.edge_size ());
+			if (vertex.size () < graph.size ())
+				vertex.resize (graph.size ());
 		}
-		std::reverse (begin(), end());
 	}
+
+	resize (len);
+	pdfs.resize (len);
+	for (unsigned int pos = len, i = index; pos-- > keep; i = level[pos][i].prev) {
+		(*this)[pos] = graph.edge (level[pos][i].edge);
+		pdfs[pos] = i;
+	}
+
+	if (! sparse)
+		for (unsigned int i = keep; i < len; ++i)
+			mark (i);
 }
 
 /* get_forward_pure ()
@@ -73,22 +121,21 @@ void History::build (Graph &graph, PDFS *e)
    (elabel1, to1) $B$N$[$&$,@h$KC5:w$5$l$k$Y$-(B
    $B$^$?(B, $B$$$^$^$G8+$?(B vertex $B$K$O@B$+$J$$(B (backward $B$N$d$/$a(B)
 */
-bool get_forward_rmpath (Graph &graph, Edge *e, int minlabel, History& history, EdgeList &result)
+bool get_forward_rmpath (const GraphRef &graph, const Edge *e, int minlabel, History& history, EdgeList &result)
 {
 	result.clear ();
-	assert (e->to >= 0 && e->to < graph.size ());
-	assert (e->from >= 0 && e->from < graph.size ());
-	int tolabel = graph[e->to].label;
+	assert (e->to >= 0 && e->to < (int)graph.size ());
+	assert (e->from >= 0 && e->from < (int)graph.size ());
+	int tolabel = graph.label (e->to);
 
-	for (Vertex::edge_iterator it = graph[e->from].edge.begin() ;
-		it != graph[e->from].edge.end() ; ++it)
+	for (const Edge *it = graph.begin (e->from); it != graph.end (e->from); ++it)
 	{
-		int tolabel2 = graph[it->to].label;
+		int tolabel2 = graph.label (it->to);
 		if (e->to == it->to || minlabel > tolabel2 || history.hasVertex (it->to))
 			continue;
 
 		if (e->elabel < it->elabel || (e->elabel == it->elabel && tolabel <= tolabel2))
-			result.push_back (&(*it));
+			result.push_back (it);
 	}
 
 	return (! result.empty());
@@ -100,24 +147,23 @@ bool get_forward_rmpath (Graph &graph, Edge *e, int minlabel, History& history,
    $B$?$@$7(B, minlabel $B$h$jBg$-$$$b$N$K$7$+$$$+$J$$(B (DFS$B$N@)Ls(B)
    $B$^$?(B, $B$$$^$^$G8+$?(B vertex $B$K$O@B$+$J$$(B (backward $B$N$d$/$a(B)
  */
-bool get_forward_pure (Graph &graph, Edge *e, int minlabel, History& history, EdgeList &result)
+bool get_forward_pure (const GraphRef &graph, const Edge *e, int minlabel, History& history, EdgeList &result)
 {
 	result.clear ();
 
-	assert (e->to >= 0 && e->to < graph.size ());
+	assert (e->to >= 0 && e->to < (int)graph.size ());
 
 	/* Walk all edges leaving from vertex e->to.
 	 */
-	for (Vertex::edge_iterator it = graph[e->to].edge.begin() ;
-		it != graph[e->to].edge.end() ; ++it)
+	for (const Edge *it = graph.begin (e->to); it != graph.end (e->to); ++it)
 	{
 		/* -e-> [e->to] -it-> [it->to]
 		 */
-		assert (it->to >= 0 && it->to < graph.size ());
-		if (minlabel > graph[it->to].label || history.hasVertex (it->to))
+		assert (it->to >= 0 && it->to < (int)graph.size ());
+		if (minlabel > graph.label (it->to) || history.hasVertex (it->to))
 			continue;
 
-		result.push_back (&(*it));
+		result.push_back (it);
 	}
 
 	return (! result.empty());
@@ -126,6 +172,18 @@ bool get_forward_pure (Graph &graph, Edge *e, int minlabel, History& history, Ed
 /* graph $B$N(B vertex $B$+$i$O$($k(B edge $B$rC5$9(B
    $B$?$@$7(B, fromlabel <= tolabel $B$N@-<A$rK~$?$9(B.
 */
+bool get_forward_root (const GraphRef &g, int v, EdgeList &result)
+{
+	result.clear ();
+	for (const Edge *it = g.begin (v); it != g.end (v); ++it) {
+		assert (it->to >= 0 && it->to < (int)g.size ());
+		if (g.label (v) <= g.label (it->to))
+			result.push_back (it);
+	}
+
+	return (! result.empty());
+}
+
 bool get_forward_root (Graph &g, Vertex &v, EdgeList &result)
 {
 	result.clear ();
@@ -146,17 +204,16 @@ bool get_forward_root (Graph &g, Vertex &v, EdgeList &result)
    (elabel1 < elabel2 ||
    (elabel == elabel2 && tolabel1 < tolabel2) $B$N>r7o$r$_$?$9(B. (elabel1, to1) $B$N$[$&$,@h$KC5:w$5$l$k$Y$-(B
  */
-Edge *get_backward (Graph &graph, Edge* e1, Edge* e2, History& history)
+const Edge *get_backward (const GraphRef &graph, const Edge* e1, const Edge* e2, History& history)
 {
 	if (e1 == e2)
 		return 0;
 
-	assert (e1->from >= 0 && e1->from < graph.size ());
-	assert (e1->to >= 0 && e1->to < graph.size ());
-	assert (e2->to >= 0 && e2->to < graph.size ());
+	assert (e1->from >= 0 && e1->from < (int)graph.size ());
+	assert (e1->to >= 0 && e1->to < (int)graph.size ());
+	assert (e2->to >= 0 && e2->to < (int)graph.size ());
 
-	for (Vertex::edge_iterator it = graph[e2->to].edge.begin() ;
-		it != graph[e2->to].edge.end() ; ++it)
+	for (const Edge *it = graph.begin (e2->to); it != graph.end (e2->to); ++it)
 	{
 		if (history.hasEdge (it->id))
 			continue;
@@ -164,10 +221,10 @@ Edge *get_backward (Graph &graph, Edge* e1, Edge* e2, History& history)
 		if ( (it->to == e1->from) &&
 			( (e1->elabel < it->elabel) ||
 				(e1->elabel == it->elabel) &&
-					(graph[e1->to].label <= graph[e2->to].label)
+					(graph.label (e1->to) <= graph.label (e2->to))
 			) )
 		{
-			return &(*it);
+			return it;
 		}
 	}
 
@@ -0,0 +1,368 @@
+/*
+   Parallel mining with work stealing.
+
+   Every frequent (fromlabel, elabel, tolabel) root edge spans an
+   independent subtree of the search, and so does every extension below
+   it.  The root subtrees are the initial tasks; they are mined by worker
+   threads, each with its own gSpan that has private search state
+   (DFS_CODE, the is_min graph and buffers, extension tables, ...) but
+   borrows TRANS and the triple index of the main object, which are only
+   read.
+
+   The search trees are very skewed (a few root edges hold most of the
+   patterns), so the roots alone do not keep the threads busy.  While some
+   thread is out of work, project () publishes child extensions that are
+   shallow and large enough as new tasks instead of recursing into them.
+   A task carries its DFS code and a flattened copy of its embeddings (one
+   array per depth, embedding j at index j of each), so it does not depend
+   on the extension tables of the thread that made it.  Every thread owns
+   a deque of tasks: it pushes and pops at the back, idle threads steal
+   from the front, where the oldest and largest tasks are.  Threads with
+   nothing to steal sleep until a task is published or the last one
+   finishes.
+
+   Every task reports into its own buffer, and records where in it the
+   results of each task it published belong.  The buffers are spliced
+   together in root order at the end, so the result is that of the
+   sequential run whatever thread mined what.
+*/
+#include "gspan.h"
+#include "parallel.h"
+
+#include <mutex>
+#include <condition_variable>
+
+namespace GSPAN {
+
+/* Only children of patterns of at most SPLIT_DEPTH edges with at least
+ * SPLIT_EMBEDDINGS embeddings are published; smaller ones are mined in
+ * place, copying them would cost about as much as mining them.
+ */
+static const unsigned int SPLIT_DEPTH      = 8;
+static const unsigned int SPLIT_EMBEDDINGS = 32;
+
+struct gSpan::MineTask {
+	DFSCode code;			// pattern of the subtree root
+	const PDFS *level0;		// root tasks: embeddings in the root table
+	Projected projected;
+	std::vector<PDFS> flat;		// other tasks: [k * n + j] = edge k of embedding j
+
+	std::vector<unsigned> results;
+	std::vector<unsigned> class_results;
+	std::vector<std::pair<std::size_t, std::unique_ptr<MineTask> > > splice;	// (results.size (), child)
+
+	MineTask (): level0 (0) {};
+
+	/* Append the results of the task and of the tasks it published, in
+	 * the order of the sequential search.
+	 */
+	void append (std::vector<unsigned> &to, std::vector<unsigned> &class_to) const
+	{
+		std::size_t pos = 0;
+		for (unsigned int i = 0; i <= splice.size (); ++i) {
+			std::size_t end = i < splice.size () ? splice[i].first : results.size ();
+			to.insert (to.end (), results.begin () + pos, results.begin () + end);
+			class_to.insert (class_to.end (), class_results.begin () + pos, class_results.begin () + end);
+			pos = end;
+			if (i < splice.size ())
+				splice[i].second->append (to, class_to);
+		}
+	}
+};
+
+class gSpan::TaskPool {
+private:
+	struct Queue {
+		std::mutex lock;
+		std::deque<MineTask *> task;
+	};
+	std::vector<Queue> queue;
+
+	std::mutex sleep;
+	std::condition_variable wake;
+	std::atomic<unsigned int> queued;	// in the queues
+
+	void notify (bool all)
+	{
+		std::lock_guard<std::mutex> guard (sleep);
+		if (all)
+			wake.notify_all ();
+		else
+			wake.notify_one ();
+	}
+
+public:
+	std::atomic<unsigned int> pending;	// published and not finished
+	std::atomic<unsigned int> idle;		// threads waiting for work
+	std::atomic<int> claimed;		// of those, lent to claim ()
+
+	TaskPool (unsigned int threads): queue (threads), queued (0), pending (0), idle (0), claimed (0) {};
+
+	/* True if some thread is out of work and nothing is queued for it
+	 * by thread t yet.
+	 */
+	bool hungry (unsigned int t)
+	{
+		if ((int)idle.load (std::memory_order_relaxed) <= claimed.load (std::memory_order_relaxed))
+			return false;
+		std::lock_guard<std::mutex> guard (queue[t].lock);
+		return queue[t].task.empty ();
+	}
+
+	void push (unsigned int t, MineTask *task)
+	{
+		++pending;
+		{
+			std::lock_guard<std::mutex> guard (queue[t].lock);
+			queue[t].task.push_back (task);
+		}
+		++queued;
+		notify (false);
+	}
+
+	/* A task taken by pop () is done.
+	 */
+	void finish ()
+	{
+		if (--pending == 0)
+			notify (true);
+	}
+
+	/* Take up to n of the waiting threads, whose cores the caller may use
+	 * until it gives them back with unclaim ().  They are not hungry in
+	 * the meantime, so no tasks are published to wake them.
+	 */
+	unsigned int claim (unsigned int n)
+	{
+		std::lock_guard<std::mutex> guard (sleep);
+		int free = (int)idle - claimed;
+		unsigned int k = free > 0 ? std::min (n, (unsigned int)free) : 0;
+		claimed += k;
+		return k;
+	}
+	void unclaim (unsigned int k)
+	{
+		std::lock_guard<std::mutex> guard (sleep);
+		claimed -= k;
+	}
+
+	/* Sleep until some task is queued or all are done.
+	 */
+	void wait ()
+	{
+		std::unique_lock<std::mutex> guard (sleep);
+		++idle;
+		wake.wait (guard, [this] { return queued > 0 || pending == 0; });
+		--idle;
+	}
+
+	/* Newest task of thread t, or else the oldest of another thread.
+	 */
+	MineTask *pop (unsigned int t)
+	{
+		for (unsigned int i = 0; i < queue.size (); ++i) {
+			Queue &q = queue[(t + i) % queue.size ()];
+			std::lock_guard<std::mutex> guard (q.lock);
+			if (q.task.empty ())
+				continue;
+			MineTask *task;
+			if (i == 0) {
+				task = q.task.back ();
+				q.task.pop_back ();
+			} else {
+				task = q.task.front ();
+				q.task.pop_front ();
+			}
+			--queued;
+			return task;
+		}
+		return 0;
+	}
+};
+
+gSpan::gSpan (const gSpan &parent, unsigned int)
+{
+	os         = parent.os;
+	ID         = 0;
+	minsup     = parent.minsup;
+	maxpat_min = parent.maxpat_min;
+	maxpat_max = parent.maxpat_max;
+	enc        = parent.enc;
+	where      = parent.where;
+	directed   = parent.directed;
+	threads    = parent.threads;
+	boost      = false;
+	n1_        = parent.n1_;
+	n2_        = parent.n2_;
+	POOL       = 0;
+	TASK       = 0;
+	WORKER     = 0;
+	terminated = false;
+	prepared   = true;
+	threshold  = 0;
+	resuming   = false;
+	LAMP       = 0;
+	WY         = 0;
+	counting   = parent.counting;
+
+	TRANS.borrow (parent.TRANS);
+	TRIPLES = parent.TRIPLES;
+	origVertexLabel = parent.origVertexLabel;
+	origEdgeLabel   = parent.origEdgeLabel;
+}
+
+/* Threads, up to n, the current thread may run for the data parallel
+ * parts of mining: all of them outside the pool, and itself plus the
+ * sleeping pool workers it claims inside, so that the machine is not
+ * oversubscribed.  Give them back with release_threads ().
+ */
+unsigned int gSpan::claim_threads (unsigned int n)
+{
+	n = std::max (1u, std::min (threads, n));
+	if (! POOL)
+		return n;
+	return 1 + POOL->claim (n - 1);
+}
+
+void gSpan::release_threads (unsigned int n)
+{
+	if (POOL && n > 1)
+		POOL->unclaim (n - 1);
+}
+
+/* Copy the embeddings of projected, the projection of DFS_CODE, with all
+ * the edges they extend into flat: edge k of embedding j at [k * n + j],
+ * where n = projected.size ().
+ */
+void gSpan::flatten (const Projected &projected, std::vector<PDFS> &flat)
+{
+	unsigned int depth = DFS_CODE.size ();
+	unsigned int n = projected.size ();
+
+	flat.resize (depth * n);
+	for (unsigned int j = 0; j < n; ++j) {
+		unsigned int idx = projected.index (j);
+		for (unsigned int k = depth; k-- > 0; ) {
+			const PDFS &p = LEVEL[k][idx];
+			PDFS &q = flat[k * n + j];
+			q.id   = p.id;
+			q.edge = p.edge;
+			q.prev = j;
+			idx = p.prev;
+		}
+	}
+}
+
+/* Make code the current pattern, with the embeddings of flat (see
+ * flatten ()), and return its projection.
+ */
+Projected gSpan::unflatten (const DFSCode &code, std::vector<PDFS> &flat)
+{
+	DFS_CODE = code;
+
+	unsigned int depth = code.size ();
+	unsigned int n = flat.size () / depth;
+	for (unsigned int k = 0; k < depth; ++k)
+		LEVEL.set (k, flat.data () + k * n);
+
+	return Projected (flat.data () + (depth - 1) * n, flat.data () + depth * n);
+}
+
+/* Publish the subtree of child, whose extension is the last element of
+ * DFS_CODE, if some thread wants work.  Returns false if the caller is to
+ * mine it itself.
+ */
+bool gSpan::spawn (Projected &child)
+{
+	if (! POOL || ! POOL->hungry (WORKER) ||
+	    DFS_CODE.size () > SPLIT_DEPTH + 1 || child.size () < SPLIT_EMBEDDINGS)
+		return false;
+
+	std::unique_ptr<MineTask> task (new MineTask);
+	task->code = DFS_CODE;
+	flatten (child, task->flat);
+
+	POOL->push (WORKER, task.get ());
+	TASK->splice.push_back (std::make_pair (results_.size (), std::move (task)));
+
+	return true;
+}
+
+void gSpan::run_task (MineTask &task)
+{
+	Projected projected;
+	if (task.flat.empty ()) {
+		DFS_CODE = task.code;
+		LEVEL.set (0, task.level0);
+		projected = task.projected;
+	} else {
+		projected = unflatten (task.code, task.flat);
+	}
+
+	TASK = &task;
+	project (projected);
+	TASK = 0;
+
+	results_.swap (task.results);
+	class_results_.swap (task.class_results);
+	results_.clear ();
+	class_results_.clear ();
+	DFS_CODE.clear ();
+
+	/* The embeddings are not needed any more; the results are.
+	 */
+	std::vector<PDFS> ().swap (task.flat);
+}
+
+/* Mine the subtrees of the sorted root table on the worker threads.
+ */
+void gSpan::project_roots (ExtensionTable &root)
+{
+	std::vector<MineTask> task (root.size ());
+	TaskPool pool (threads);
+
+	for (unsigned int n = root.size (); n-- > 0; ) {
+		task[n].code.push (0, 1, root.fromlabel (n), root.elabel (n), root.tolabel (n));
+		task[n].level0 = root.data ();
+		task[n].projected = root[n];
+		pool.push (n % threads, &task[n]);
+	}
+
+	std::vector<std::unique_ptr<gSpan> > worker (threads);
+	parallel_for (threads, threads, [&] (unsigned int, unsigned int t) {
+			if (! worker[t]) {
+				worker[t].reset (new gSpan (*this, 0));
+				worker[t]->POOL = &pool;
+				worker[t]->WORKER = t;
+			}
+			gSpan &w = *worker[t];
+
+			while (true) {
+				if (MineTask *next = pool.pop (t)) {
+					w.run_task (*next);
+					pool.finish ();
+				} else if (pool.pending == 0) {
+					break;
+				} else {
+					pool.wait ();
+				}
+			}
+		});
+
+	for (unsigned int t = 0; t < threads; ++t) {
+		if (! worker[t])
+			continue;
+		std::vector<std::size_t> &h = worker[t]->histogram_;
+		if (histogram_.size () < h.size ())
+			histogram_.resize (h.size (), 0);
+		for (unsigned int s = 0; s < h.size (); ++s)
+			histogram_[s] += h[s];
+	}
+
+	std::size_t before = results_.size ();
+	for (unsigned int n = 0; n < root.size (); ++n)
+		task[n].append (results_, class_results_);
+	ID += results_.size () - before;
+}
+
+}
@@ -0,0 +1,223 @@
+/*
+   Frequency based pruning and relabeling (section 4 of [Yan2002]).
+
+   Once minsup is known, vertices whose label appears in fewer than minsup
+   graphs and edges whose (fromlabel, elabel, tolabel) triple appears in
+   fewer than minsup graphs cannot be part of any frequent pattern.  They
+   are dropped from a working copy of the database, and the remaining
+   labels are renumbered densely by descending frequency.  Graph ids are
+   kept, so supports and class/boosting data indexed by id are unaffected.
+*/
+#include "gspan.h"
+
+#include <stdint.h>
+
+namespace GSPAN {
+
+/* Dense index of label among the sorted distinct labels.
+ */
+static inline unsigned int index_of (const std::vector<int> &labels, int label)
+{
+	return std::lower_bound (labels.begin (), labels.end (), label) - labels.begin ();
+}
+
+/* Packed key of an edge between vertex labels a and b; undirected edges
+   are keyed with the smaller label first.
+ */
+static inline uint64_t triple (int a, int elabel, int b, bool directed)
+{
+	if (! directed && a > b)
+		std::swap (a, b);
+	return ((uint64_t)a << 42) | ((uint64_t)elabel << 21) | (uint64_t)b;
+}
+
+/* Renumber the labels with support >= minsup by descending support (ties
+   by label value).  Returns the new label of every index, -1 if dropped,
+   and fills orig with the original label of every new label.
+ */
+static std::vector<int> rank_labels (const std::vector<int> &labels, const std::vector<unsigned int> &sup,
+				     unsigned int minsup, std::vector<int> &orig)
+{
+	std::vector<unsigned int> order;
+	for (unsigned int i = 0; i < labels.size (); ++i)
+		if (sup[i] >= minsup)
+			order.push_back (i);
+
+	std::stable_sort (order.begin (), order.end (),
+			  [&sup] (unsigned int a, unsigned int b) { return sup[a] > sup[b]; });
+
+	std::vector<int> rank (labels.size (), -1);
+	orig.resize (order.size ());
+	for (unsigned int r = 0; r < order.size (); ++r) {
+		rank[order[r]] = r;
+		orig[r] = labels[order[r]];
+	}
+
+	return rank;
+}
+
+void gSpan::preprocess ()
+{
+	/* Distinct vertex and edge labels.
+	 */
+	std::vector<int> vlabels, elabels;
+	for (unsigned int id = 0; id < INPUT.size (); ++id) {
+		GraphRef g = INPUT[id];
+		for (unsigned int v = 0; v < g.size (); ++v) {
+			vlabels.push_back (g.label (v));
+			for (const Edge *e = g.begin (v); e != g.end (v); ++e)
+				elabels.push_back (e->elabel);
+		}
+	}
+	std::sort (vlabels.begin (), vlabels.end ());
+	vlabels.erase (std::unique (vlabels.begin (), vlabels.end ()), vlabels.end ());
+	std::sort (elabels.begin (), elabels.end ());
+	elabels.erase (std::unique (elabels.begin (), elabels.end ()), elabels.end ());
+
+	/* 1-vertex supports.
+	 */
+	std::vector<unsigned int> vsup (vlabels.size (), 0), seen (vlabels.size (), 0xffffffff);
+	for (unsigned int id = 0; id < INPUT.size (); ++id) {
+		GraphRef g = INPUT[id];
+		for (unsigned int v = 0; v < g.size (); ++v) {
+			unsigned int l = index_of (vlabels, g.label (v));
+			if (seen[l] != id) {
+				seen[l] = id;
+				++vsup[l];
+			}
+		}
+	}
+	std::vector<int> vrank = rank_labels (vlabels, vsup, minsup, origVertexLabel);
+
+	/* 1-edge supports over edges between frequent vertices, keyed on the
+	 * packed (fromlabel, elabel, tolabel) triple.
+	 */
+	std::vector<std::pair<uint64_t, unsigned int> > occ;
+	for (unsigned int id = 0; id < INPUT.size (); ++id) {
+		GraphRef g = INPUT[id];
+		for (unsigned int v = 0; v < g.size (); ++v) {
+			int lv = vrank[index_of (vlabels, g.label (v))];
+			for (const Edge *e = g.begin (v); e != g.end (v); ++e) {
+				int lt = vrank[index_of (vlabels, g.label (e->to))];
+				if (lv < 0 || lt < 0)
+					continue;
+				occ.push_back (std::make_pair (triple (lv, index_of (elabels, e->elabel), lt, directed), id));
+			}
+		}
+	}
+	std::sort (occ.begin (), occ.end ());
+	occ.erase (std::unique (occ.begin (), occ.end ()), occ.end ());
+
+	std::vector<uint64_t> frequent;
+	for (unsigned int i = 0, j; i < occ.size (); i = j) {
+		for (j = i; j < occ.size () && occ[j].first == occ[i].first; ++j)
+			;
+		if (j - i >= minsup)
+			frequent.push_back (occ[i].first);
+	}
+
+	/* Edge label supports over the frequent edges.
+	 */
+	std::vector<unsigned int> esup (elabels.size (), 0);
+	seen.assign (elabels.size (), 0xffffffff);
+	for (unsigned int i = 0; i < occ.size (); ++i) {
+		if (! std::binary_search (frequent.begin (), frequent.end (), occ[i].first))
+			continue;
+		unsigned int l = (occ[i].first >> 21) & 0x1fffff;
+		if (seen[l] != occ[i].second) {
+			seen[l] = occ[i].second;
+			++esup[l];
+		}
+	}
+	std::vector<int> erank = rank_labels (elabels, esup, 1, origEdgeLabel);
+
+	/* Graphs of the frequent triples, keyed with the final labels, for
+	 * the extension filter of project ().
+	 */
+	std::vector<std::pair<uint64_t, unsigned int> > renamed;
+	for (unsigned int i = 0; i < frequent.size (); ++i) {
+		int a = ExtensionTable::field (frequent[i], 0);
+		int l = ExtensionTable::field (frequent[i], 1);
+		int b = ExtensionTable::field (frequent[i], 2);
+		renamed.push_back (std::make_pair (triple (a, erank[l], b, directed), i));
+	}
+	std::sort (renamed.begin (), renamed.end ());
+
+	std::shared_ptr<TripleIndex> triples (new TripleIndex);
+	triples->key.resize (renamed.size ());
+	triples->tids.assign (renamed.size (), TidSet ());
+	for (unsigned int i = 0; i < renamed.size (); ++i) {
+		triples->key[i] = renamed[i].first;
+		triples->tids[i].reset (INPUT.size ());
+		uint64_t key = frequent[renamed[i].second];
+		for (std::vector<std::pair<uint64_t, unsigned int> >::iterator it =
+			     std::lower_bound (occ.begin (), occ.end (), std::make_pair (key, 0u));
+		     it != occ.end () && it->first == key; ++it)
+			triples->tids[i].set (it->second);
+	}
+	TRIPLES = triples;
+
+	/* Build the working copy.  Vertices left without edges are dropped as
+	 * well; single vertex patterns are counted on INPUT.
+	 */
+	TRANS.clear ();
+	TRANS.directed = INPUT.directed;
+
+	std::vector<int> newid;
+	for (unsigned int id = 0; id < INPUT.size (); ++id) {
+		GraphRef g = INPUT[id];
+		newid.assign (g.size (), -1);
+
+		for (unsigned int v = 0; v < g.size (); ++v) {
+			int lv = vrank[index_of (vlabels, g.label (v))];
+			for (const Edge *e = g.begin (v); e != g.end (v); ++e) {
+				int lt = vrank[index_of (vlabels, g.label (e->to))];
+				if (lv < 0 || lt < 0 ||
+				    ! std::binary_search (frequent.begin (), frequent.end (),
+							  triple (lv, index_of (elabels, e->elabel), lt, directed)))
+					continue;
+
+				newid[v] = newid[e->to] = 0;
+				TRANS.new_edge.push_back (*e);
+			}
+		}
+
+		for (unsigned int v = 0; v < g.size (); ++v) {
+			if (newid[v] < 0)
+				continue;
+			newid[v] = TRANS.new_label.size ();
+			TRANS.new_label.push_back (vrank[index_of (vlabels, g.label (v))]);
+		}
+
+		for (unsigned int i = 0; i < TRANS.new_edge.size (); ++i) {
+			Edge &e = TRANS.new_edge[i];
+			e.from   = newid[e.from];
+			e.to     = newid[e.to];
+			e.elabel = erank[index_of (elabels, e.elabel)];
+		}
+
+		TRANS.end_graph ();
+	}
+}
+
+const TidSet *gSpan::triple_tids (int fromlabel, int elabel, int tolabel)
+{
+	uint64_t key = triple (fromlabel, elabel, tolabel, directed);
+	const std::vector<uint64_t> &keys = TRIPLES->key;
+	std::vector<uint64_t>::const_iterator it = std::lower_bound (keys.begin (), keys.end (), key);
+
+	return it != keys.end () && *it == key ? &TRIPLES->tids[it - keys.begin ()] : 0;
+}
+
+/* Map the labels of a pattern graph back to the input labels.
+ */
+void gSpan::restore_labels (Graph &g)
+{
+	for (unsigned int v = 0; v < g.size (); ++v) {
+		g[v].label = origVertexLabel[g[v].label];
+		for (Vertex::edge_iterator it = g[v].edge.begin (); it != g[v].edge.end (); ++it)
+			it->elabel = origEdgeLabel[it->elabel];
+	}
+}
+
+}
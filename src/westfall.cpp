@@ -0,0 +1,121 @@
+/*
+   Westfall-Young permutation testing in one search (WYlight).
+
+   The family-wise error rate of testing every pattern at level delta is
+   estimated by permuting the classes of the graphs J times: it is the
+   fraction of permutations under which some pattern reaches a p-value
+   <= delta.  The largest delta with an estimate <= alpha is the
+   (floor (alpha J) + 1)-th smallest of the minimum p-values of the
+   permutations, less conservative than the Bonferroni style correction
+   of lamp ().
+
+   The permutations are drawn before mining, as bitsets of the graphs
+   that fall in the first class under each.  The support of a pattern
+   in the first class under permutation j is then the popcount of its
+   graphs ANDed with PERMUTED[j], and its p-value a lookup.  A pattern of
+   support x reaches p-values >= phi (x) only, so once the minimum
+   p-values found so far are <= phi (minsup) under more than alpha J
+   permutations the corrected threshold is below phi (minsup), and the
+   patterns of support minsup and less cannot change it: minsup is raised
+   and the search prunes them.
+*/
+#include "gspan.h"
+#include "fisher.hpp"
+
+#include <random>
+#include <numeric>
+
+namespace GSPAN {
+
+void gSpan::permutation_test (const TidSet &tids, unsigned int sup)
+{
+	/* No permutation can improve.
+	 */
+	if (WY->min_p (sup) >= wymax)
+		return;
+
+	bool improved = false;
+	for (unsigned int j = 0; j < PERMUTED.size (); ++j) {
+		double p = WY->p_value (sup, TidSet::count_and (tids, PERMUTED[j]));
+		if (p < wymin[j]) {
+			wymin[j] = p;
+			improved = true;
+		}
+	}
+	if (! improved)
+		return;
+
+	wymax = *std::max_element (wymin.begin (), wymin.end ());
+
+	while (minsup <= TRANS.size ()) {
+		double phi = WY->min_p (minsup);
+		unsigned int failing = 0;
+		for (unsigned int j = 0; j < wymin.size (); ++j)
+			failing += (wymin[j] <= phi);
+		if (failing <= wyalpha * wymin.size ())
+			break;
+		++minsup;
+	}
+}
+
+double gSpan::westfall_young (const unsigned int J, const double alpha, const unsigned int seed)
+{
+	if (n1_ == 0) {
+		std::cerr << "westfall_young () needs the classes of the graphs" << std::endl;
+		exit (-1);
+	}
+	if (J == 0) {
+		std::cerr << "westfall_young () needs at least one permutation" << std::endl;
+		exit (-1);
+	}
+
+	/* Below the minimum admissible support no pattern can be significant
+	 * even on its own.
+	 */
+	thesis::Fisher fisher (n1_, n2_);
+	unsigned int lowest = 1;
+	while (lowest < n1_ && fisher.min_p (lowest) > alpha)
+		++lowest;
+
+	reset (lowest);
+
+	std::mt19937 rng (seed);
+	std::vector<unsigned int> ids (TRANS.size ());
+	std::iota (ids.begin (), ids.end (), 0);
+	PERMUTED.resize (J);
+	for (unsigned int j = 0; j < J; ++j) {
+		std::shuffle (ids.begin (), ids.end (), rng);
+		PERMUTED[j].reset (TRANS.size ());
+		for (unsigned int i = 0; i < n1_; ++i)
+			PERMUTED[j].set (ids[i]);
+	}
+	wymin.assign (J, 1.0);
+	wymax = 1.0;
+
+	histogram_.assign (lowest + 1, 0);
+	counting = true;
+	WY = &fisher;
+	wyalpha = alpha;
+	run_intern ();
+	WY = 0;
+	counting = false;
+
+	/* The patterns pruned have p-values >= phi (minsup - 1): either minsup
+	 * was raised past minsup - 1, which puts the quantile at or below it,
+	 * or minsup - 1 is below the lowest admissible support and the
+	 * threshold is capped there.
+	 */
+	std::vector<double> p (wymin);
+	std::sort (p.begin (), p.end ());
+	unsigned int k = (unsigned int) (alpha * J);
+	double delta = k < J ? p[k] : 1.0;
+	if (minsup > 1)
+		delta = std::min (delta, fisher.min_p (minsup - 1));
+
+	minsup = lowest;	// what TRANS was built for
+	std::vector<TidSet> ().swap (PERMUTED);
+
+	return delta;
+}
+
+}